@@ -18,6 +18,7 @@ export const CONFIG = {
   
   // File settings
   LARGE_FILE_THRESHOLD: 10 * 1024 * 1024, // 10MB
+  HASH_LEAF_SIZE: 1024 * 1024, // Same as STORAGE_CHUNK_SIZE in config.env
   PROGRESS_LOG_INTERVAL: 5 // Log progress every 5%
 };
 
@@ -39,6 +40,14 @@ export function getUploadUrl() {
   return `${getBackendUrl()}/upload`;
 }
 
+/**
+ * Get the endpoint that links content the server already stores
+ * @returns {string} Existing upload endpoint URL
+ */
+export function getExistingUploadUrl() {
+  return `${getBackendUrl()}/upload/existing`;
+}
+
 /**
  * Log configuration information
  */
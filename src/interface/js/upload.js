@@ -2,8 +2,8 @@
  * Upload management module for RapidComm upload interface
  */
 
-import { CONFIG, getUploadUrl, getBackendUrl } from './config.js';
-import { formatFileSize, verifyFileIntegrity, throttle } from './utils.js';
+import { CONFIG, getUploadUrl, getBackendUrl, getExistingUploadUrl } from './config.js';
+import { formatFileSize, calculateFileHash, verifyFileIntegrity, throttle } from './utils.js';
 
 /**
  * Upload Manager class to handle file uploads
@@ -86,18 +86,64 @@ export class UploadManager {
   }
 
   /**
-   * Upload a single file with progress tracking
+   * Upload a single file, or link it when the server already stores it
    * @param {File} file - File to upload
    * @param {number} currentIndex - Current file index
    * @param {number} totalFiles - Total number of files
    * @returns {Promise} Promise that resolves with upload result
    */
-  uploadSingleFile(file, currentIndex, totalFiles) {
+  async uploadSingleFile(file, currentIndex, totalFiles) {
+    // Large files are hashed first: a repeat upload is then one round trip
+    let originalHash = null;
+    if (file.size >= CONFIG.LARGE_FILE_THRESHOLD) {
+      originalHash = await calculateFileHash(file, CONFIG.HASH_LEAF_SIZE);
+      const existing = originalHash && await this.linkExistingFile(file, originalHash);
+      if (existing) {
+        this.handleUploadProgress({ loaded: file.size, total: file.size }, file, currentIndex, totalFiles);
+        return existing;
+      }
+    }
+    return this.sendFile(file, currentIndex, totalFiles, originalHash);
+  }
+
+  /**
+   * Ask the server to link content it already stores under this file's name
+   * @param {File} file - File to upload
+   * @param {string} hash - File hash, as sent in originalHash
+   * @returns {Promise<Object|null>} Upload result, or null when the file has to be sent
+   */
+  async linkExistingFile(file, hash) {
+    try {
+      const url = `${getExistingUploadUrl()}?filename=${encodeURIComponent(file.name)}&size=${file.size}`;
+      const response = await fetch(url, { method: 'POST', headers: { 'X-Original-Hash': hash } });
+      if (!response.ok) {
+        return null;
+      }
+      const result = await response.json();
+      return result.status === 'success' ? result : null;
+    } catch (error) {
+      return null;
+    }
+  }
+
+  /**
+   * Send a single file with progress tracking
+   * @param {File} file - File to upload
+   * @param {number} currentIndex - Current file index
+   * @param {number} totalFiles - Total number of files
+   * @param {string|null} originalHash - File hash for the server to verify, if computed
+   * @returns {Promise} Promise that resolves with upload result
+   */
+  sendFile(file, currentIndex, totalFiles, originalHash) {
     return new Promise((resolve, reject) => {
+      // Fields ahead of the file let the server check its size as it arrives
       const formData = new FormData();
-      formData.append('file', file);
       formData.append('originalSize', file.size.toString());
+      if (originalHash) {
+        formData.append('originalHash', originalHash);
+      }
       formData.append('timestamp', Date.now().toString());
+      formData.append('file', file);
 
       const xhr = new XMLHttpRequest();
       const uploadId = `upload_${currentIndex}_${Date.now()}`;
@@ -16,66 +16,198 @@ export function formatFileSize(bytes) {
 }
 
 /**
- * Calculate hash of file for integrity verification (compatible with server)
+ * Calculate the hash of a file in the server's format: "sha256:<hex>", or
+ * "merkle-sha256:<leafSize>:<hex>" when a leaf size is given
  * @param {File} file - File object to hash
+ * @param {number} leafSize - Leaf size of the hash tree, 0 for plain SHA-256
  * @returns {Promise<string>} File hash
  */
-export async function calculateFileHash(file) {
-  const arrayBuffer = await file.arrayBuffer();
-  const dataArray = new Uint8Array(arrayBuffer);
-
-  // Simple hash algorithm that matches server implementation
-  let hash1 = 0;
-  let hash2 = 0;
-  let hash3 = 0;
-
-  // Hash pass 1: Basic hash
-  for (let i = 0; i < dataArray.length; i++) {
-    hash1 = ((hash1 << 5) - hash1 + dataArray[i]) & 0xffffffff;
+export async function calculateFileHash(file, leafSize = 0) {
+  if (leafSize > 0) {
+    const root = await calculateMerkleRoot(file, leafSize);
+    return `merkle-sha256:${leafSize}:${toHex(root)}`;
   }
 
-  // Hash pass 2: With salt1 - process salt1 chars first, then data
-  const salt1 = "salt1";
-  for (let i = 0; i < dataArray.length; i++) {
-    hash2 = ((hash2 << 5) - hash2 + dataArray[i]) & 0xffffffff;
+  if (hasWebCrypto()) {
+    const arrayBuffer = await file.arrayBuffer();
+    return "sha256:" + toHex(await window.crypto.subtle.digest("SHA-256", arrayBuffer));
   }
-  for (let i = 0; i < salt1.length; i++) {
-    hash2 = ((hash2 << 5) - hash2 + salt1.charCodeAt(i)) & 0xffffffff;
+
+  // Read in slices, so the fallback never holds the whole file at once
+  const hasher = new Sha256();
+  for (let offset = 0; offset < file.size; offset += FALLBACK_SLICE_SIZE) {
+    hasher.update(new Uint8Array(await file.slice(offset, offset + FALLBACK_SLICE_SIZE).arrayBuffer()));
   }
+  return "sha256:" + toHex(hasher.digest());
+}
 
-  // Hash pass 3: With salt2 and size - process data first, then salt2
-  const salt2 = "salt2" + dataArray.length.toString();
-  for (let i = 0; i < dataArray.length; i++) {
-    hash3 = ((hash3 << 5) - hash3 + dataArray[i]) & 0xffffffff;
+/**
+ * Root of the server's hash tree: leaves are SHA-256(0x00 || leaf), parents
+ * SHA-256(0x01 || left || right), an unpaired node moves up unchanged
+ * @param {File} file - File object to hash
+ * @param {number} leafSize - Bytes per leaf
+ * @returns {Promise<ArrayBuffer>} Root digest
+ */
+async function calculateMerkleRoot(file, leafSize) {
+  let level = [];
+  for (let offset = 0; offset < file.size || level.length === 0; offset += leafSize) {
+    const leaf = new Uint8Array(await file.slice(offset, offset + leafSize).arrayBuffer());
+    const tagged = new Uint8Array(leaf.length + 1);
+    tagged.set(leaf, 1);
+    level.push(await sha256(tagged));
   }
-  for (let i = 0; i < salt2.length; i++) {
-    hash3 = ((hash3 << 5) - hash3 + salt2.charCodeAt(i)) & 0xffffffff;
+
+  while (level.length > 1) {
+    const parents = [];
+    for (let i = 0; i < level.length; i += 2) {
+      if (i + 1 === level.length) {
+        parents.push(level[i]);
+        break;
+      }
+      const node = new Uint8Array(65);
+      node[0] = 1;
+      node.set(new Uint8Array(level[i]), 1);
+      node.set(new Uint8Array(level[i + 1]), 33);
+      parents.push(await sha256(node));
+    }
+    level = parents;
   }
+  return level[0];
+}
+
+// crypto.subtle only exists in secure contexts (https or localhost); the
+// frontend is usually reached over plain http on the LAN, so the pure-JS
+// SHA-256 below stands in for it there
+const FALLBACK_SLICE_SIZE = 4 * 1024 * 1024;
 
-  // Calculate checksum (similar to server)
-  let checksum = 0;
-  for (let i = 0; i < dataArray.length; i++) {
-    checksum = checksum ^ dataArray[i];
-    checksum = (checksum << 1) | (checksum >>> 31); // Rotate left by 1
+function hasWebCrypto() {
+  return typeof window !== "undefined" && !!window.crypto && !!window.crypto.subtle;
+}
+
+/**
+ * SHA-256 of some bytes, through Web Crypto where there is one
+ * @param {Uint8Array} bytes - Data to hash
+ * @returns {Promise<ArrayBuffer>} Digest
+ */
+async function sha256(bytes) {
+  if (hasWebCrypto()) {
+    return window.crypto.subtle.digest("SHA-256", bytes);
   }
-  checksum = checksum >>> 0; // Ensure unsigned 32-bit
-
-  // Combine hashes and format as hex (similar to server)
-  let result =
-    hash1.toString(16) +
-    hash2.toString(16) +
-    hash3.toString(16) +
-    checksum.toString(16);
-
-  // Pad to 64 characters
-  while (result.length < 64) {
-    result += "0";
+  const hasher = new Sha256();
+  hasher.update(bytes);
+  return hasher.digest().buffer;
+}
+
+const SHA256_K = new Uint32Array([
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+]);
+
+/**
+ * Incremental SHA-256 (FIPS 180-4) in plain JavaScript
+ */
+class Sha256 {
+  constructor() {
+    this.state = new Uint32Array([
+      0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    ]);
+    this.block = new Uint8Array(64);
+    this.words = new Uint32Array(64);
+    this.buffered = 0;
+    this.length = 0;
+  }
+
+  /**
+   * @param {Uint8Array} bytes - Next piece of the data
+   */
+  update(bytes) {
+    this.length += bytes.length;
+    let offset = 0;
+    while (offset < bytes.length) {
+      const take = Math.min(64 - this.buffered, bytes.length - offset);
+      this.block.set(bytes.subarray(offset, offset + take), this.buffered);
+      this.buffered += take;
+      offset += take;
+      if (this.buffered === 64) {
+        this.compress();
+        this.buffered = 0;
+      }
+    }
   }
-  if (result.length > 64) {
-    result = result.substring(0, 64);
+
+  /**
+   * Digest of everything fed so far; no more data may follow
+   * @returns {Uint8Array} 32-byte digest
+   */
+  digest() {
+    const bitLength = this.length * 8;
+    const padding = new Uint8Array((this.buffered < 56 ? 56 : 120) - this.buffered + 8);
+    padding[0] = 0x80;
+    const view = new DataView(padding.buffer);
+    view.setUint32(padding.length - 8, Math.floor(bitLength / 0x100000000));
+    view.setUint32(padding.length - 4, bitLength >>> 0);
+    this.update(padding);
+
+    const out = new Uint8Array(32);
+    const outView = new DataView(out.buffer);
+    this.state.forEach((word, i) => outView.setUint32(i * 4, word));
+    return out;
+  }
+
+  compress() {
+    const w = this.words;
+    const block = this.block;
+    for (let i = 0; i < 16; i++) {
+      w[i] = (block[i * 4] << 24) | (block[i * 4 + 1] << 16) | (block[i * 4 + 2] << 8) | block[i * 4 + 3];
+    }
+    for (let i = 16; i < 64; i++) {
+      const a = w[i - 15];
+      const b = w[i - 2];
+      const s0 = ((a >>> 7) | (a << 25)) ^ ((a >>> 18) | (a << 14)) ^ (a >>> 3);
+      const s1 = ((b >>> 17) | (b << 15)) ^ ((b >>> 19) | (b << 13)) ^ (b >>> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    let [a, b, c, d, e, f, g, h] = this.state;
+    for (let i = 0; i < 64; i++) {
+      const s1 = ((e >>> 6) | (e << 26)) ^ ((e >>> 11) | (e << 21)) ^ ((e >>> 25) | (e << 7));
+      const ch = (e & f) ^ (~e & g);
+      const t1 = (h + s1 + ch + SHA256_K[i] + w[i]) | 0;
+      const s0 = ((a >>> 2) | (a << 30)) ^ ((a >>> 13) | (a << 19)) ^ ((a >>> 22) | (a << 10));
+      const maj = (a & b) ^ (a & c) ^ (b & c);
+      const t2 = (s0 + maj) | 0;
+      h = g;
+      g = f;
+      f = e;
+      e = (d + t1) | 0;
+      d = c;
+      c = b;
+      b = a;
+      a = (t1 + t2) | 0;
+    }
+
+    const state = this.state;
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
   }
+}
 
-  return result;
+function toHex(buffer) {
+  return Array.from(new Uint8Array(buffer))
+    .map((byte) => byte.toString(16).padStart(2, "0"))
+    .join("");
 }
 
 /**
@@ -117,8 +249,13 @@ export async function verifyFileIntegrity(originalFile, uploadedSize, serverHash
       return false;
     }
 
-    // Calculate original file hash
-    const originalHash = await calculateFileHash(originalFile);
+    // Hash the original the same way the server did
+    const tree = /^merkle-sha256:(\d+):/.exec(serverHash);
+    if (!tree && !serverHash.startsWith("sha256:")) {
+      console.warn(`[Integrity Check] Unknown hash format, not verified: ${serverHash}`);
+      return false;
+    }
+    const originalHash = await calculateFileHash(originalFile, tree ? Number(tree[1]) : 0);
 
     // Compare hashes
     if (originalHash !== serverHash) {
@@ -129,9 +266,9 @@ export async function verifyFileIntegrity(originalFile, uploadedSize, serverHash
     }
 
     console.log(
-      `[Integrity Check] ✅ File integrity verified - SHA256: ${originalHash.substring(
+      `[Integrity Check] ✅ File integrity verified - ${originalHash.substring(
         0,
-        16
+        23
       )}...`
     );
     return true;
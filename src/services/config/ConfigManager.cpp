@@ -1,7 +1,9 @@
 #include "ConfigManager.hpp"
+#include "../storage/MerkleHasher.hpp"
 #include <iostream>
 #include <algorithm>
 #include <cctype>
+#include <atomic>
 
 // Colors for terminal output
 #define COLOR_GREEN   "\033[0;32m"
@@ -12,13 +14,13 @@
 
 // ----------------------------- Constructor/Destructor --------------------------------->
 
-ConfigManager::ConfigManager() : configFilePath("../../config.env")
+ConfigManager::ConfigManager() : configFilePath("../../config.env"), loaded(false)
 {
     setDefaults();
     loadConfig(configFilePath);
 }
 
-ConfigManager::ConfigManager(const std::string& configFile) : configFilePath(configFile)
+ConfigManager::ConfigManager(const std::string& configFile) : configFilePath(configFile), loaded(false)
 {
     setDefaults();
     loadConfig(configFile);
@@ -29,6 +31,30 @@ ConfigManager::~ConfigManager()
     // No cleanup needed
 }
 
+// ----------------------------- Snapshot --------------------------------->
+
+static std::shared_ptr<const ConfigManager>& getSnapshot()
+{
+    static std::shared_ptr<const ConfigManager> snapshot = std::make_shared<const ConfigManager>();
+    return snapshot;
+}
+
+std::shared_ptr<const ConfigManager> ConfigManager::current()
+{
+    return std::atomic_load(&getSnapshot());
+}
+
+bool ConfigManager::reload()
+{
+    std::shared_ptr<const ConfigManager> fresh = std::make_shared<const ConfigManager>(current()->getConfigFile());
+    if (!fresh->isLoaded()) {
+        fresh->logError("Keeping the current configuration");
+        return false;
+    }
+    std::atomic_store(&getSnapshot(), fresh);
+    return true;
+}
+
 // ----------------------------- Load Configuration --------------------------------->
 
 bool ConfigManager::loadConfig(const std::string& configFile)
@@ -40,6 +66,7 @@ bool ConfigManager::loadConfig(const std::string& configFile)
     std::ifstream file(configFilePath);
     if (!file.is_open()) {
         logError("Could not open config file: " + configFilePath + ". Using defaults.");
+        parseSettings();
         return false;
     }
     
@@ -64,10 +91,22 @@ bool ConfigManager::loadConfig(const std::string& configFile)
     }
     
     file.close();
+    parseSettings();
+    loaded = true;
     logInfo("Configuration loaded from: " + configFilePath);
     return true;
 }
 
+bool ConfigManager::isLoaded() const
+{
+    return loaded;
+}
+
+const std::string& ConfigManager::getConfigFile() const
+{
+    return configFilePath;
+}
+
 // ----------------------------- Get Configuration Values --------------------------------->
 
 std::string ConfigManager::getString(const std::string& key, const std::string& defaultValue) const
@@ -126,21 +165,25 @@ size_t ConfigManager::getSize(const std::string& key, size_t defaultValue) const
 void ConfigManager::setString(const std::string& key, const std::string& value)
 {
     config[key] = value;
+    parseSettings();
 }
 
 void ConfigManager::setInt(const std::string& key, int value)
 {
     config[key] = std::to_string(value);
+    parseSettings();
 }
 
 void ConfigManager::setBool(const std::string& key, bool value)
 {
     config[key] = value ? "true" : "false";
+    parseSettings();
 }
 
 void ConfigManager::setSize(const std::string& key, size_t value)
 {
     config[key] = std::to_string(value);
+    parseSettings();
 }
 
 // ----------------------------- Utility Functions --------------------------------->
@@ -159,47 +202,112 @@ std::map<std::string, std::string> ConfigManager::getAllConfig() const
 
 int ConfigManager::getFrontendPort() const
 {
-    return getInt("FRONTEND_PORT", 3000);
+    return settings.frontendPort;
 }
 
 int ConfigManager::getBackendPort() const
 {
-    return getInt("BACKEND_PORT", 8080);
+    return settings.backendPort;
+}
+
+int ConfigManager::getListenBacklog() const
+{
+    return settings.listenBacklog;
+}
+
+size_t ConfigManager::getAcceptShards() const
+{
+    return settings.acceptShards;
+}
+
+int ConfigManager::getKeepAliveTimeout() const
+{
+    return settings.keepAliveTimeout;
+}
+
+size_t ConfigManager::getKeepAliveMaxRequests() const
+{
+    return settings.keepAliveMaxRequests;
+}
+
+bool ConfigManager::isIoUringEnabled() const
+{
+    return settings.ioUring;
+}
+
+size_t ConfigManager::getMaxConcurrentUploads() const
+{
+    return settings.maxConcurrentUploads;
+}
+
+size_t ConfigManager::getUploadMemoryBudget() const
+{
+    return settings.uploadMemoryBudget;
+}
+
+int ConfigManager::getUploadRetryAfter() const
+{
+    return settings.uploadRetryAfter;
 }
 
 std::string ConfigManager::getStorageDirectory() const
 {
-    std::string dir = getString("STORAGE_DIRECTORY", "./uploads/");
-    // Ensure directory ends with slash
-    if (!dir.empty() && dir.back() != '/') {
-        dir += '/';
-    }
-    return dir;
+    return settings.storageDirectory;
 }
 
 size_t ConfigManager::getMaxFileSize() const
 {
-    return getSize("STORAGE_MAX_FILE_SIZE", 104857600); // 100MB default
+    return settings.maxFileSize;
 }
 
 size_t ConfigManager::getChunkSize() const
 {
-    return getSize("STORAGE_CHUNK_SIZE", 65536); // 64KB default
+    return settings.chunkSize;
+}
+
+size_t ConfigManager::getMaxUploadSessions() const
+{
+    return settings.maxUploadSessions;
+}
+
+bool ConfigManager::isDedupEnabled() const
+{
+    return settings.dedup;
+}
+
+bool ConfigManager::isDurableEnabled() const
+{
+    return settings.durable;
+}
+
+bool ConfigManager::isDirectIoEnabled() const
+{
+    return settings.directIo;
+}
+
+bool ConfigManager::isPipelineEnabled() const
+{
+    return settings.pipeline;
+}
+
+std::string ConfigManager::getConflictPolicy() const
+{
+    return settings.conflictPolicy;
 }
 
 bool ConfigManager::isFileVerificationEnabled() const
 {
-    return getBool("ENABLE_FILE_VERIFICATION", true);
+    return settings.fileVerification;
 }
 
 bool ConfigManager::isProgressTrackingEnabled() const
 {
-    return getBool("ENABLE_PROGRESS_TRACKING", true);
+    return settings.progressTracking;
 }
 
 std::string ConfigManager::getLogLevel() const
 {
-    return getString("LOG_LEVEL", "INFO");
+    return settings.logLevel;
 }
 
 // ----------------------------- Helper Functions --------------------------------->
@@ -240,11 +348,25 @@ void ConfigManager::setDefaults()
     // Server defaults
     config["FRONTEND_PORT"] = "3000";
     config["BACKEND_PORT"] = "8080";
+    config["SERVER_LISTEN_BACKLOG"] = "1024";
+    config["SERVER_ACCEPT_SHARDS"] = "0";
+    config["SERVER_KEEPALIVE_TIMEOUT"] = "15";
+    config["SERVER_KEEPALIVE_MAX_REQUESTS"] = "1000";
+    config["SERVER_IO_URING"] = "true";
+    config["MAX_CONCURRENT_UPLOADS"] = "10";
+    config["UPLOAD_MEMORY_BUDGET"] = "268435456"; // 256MB
+    config["UPLOAD_RETRY_AFTER"] = "5";
     
     // Storage defaults
     config["STORAGE_DIRECTORY"] = "./uploads/";
     config["STORAGE_MAX_FILE_SIZE"] = "104857600"; // 100MB
     config["STORAGE_CHUNK_SIZE"] = "65536"; // 64KB
+    config["STORAGE_MAX_SESSIONS"] = "64";
+    config["STORAGE_DEDUP"] = "false";
+    config["STORAGE_DURABLE"] = "false";
+    config["STORAGE_DIRECT_IO"] = "false";
+    config["STORAGE_PIPELINE"] = "true";
+    config["STORAGE_CONFLICT_POLICY"] = "overwrite";
     
     // Application defaults
     config["LOG_LEVEL"] = "INFO";
@@ -256,6 +378,43 @@ void ConfigManager::setDefaults()
     config["VERBOSE_LOGGING"] = "true";
 }
 
+void ConfigManager::parseSettings()
+{
+    settings.frontendPort = getInt("FRONTEND_PORT", 3000);
+    settings.backendPort = getInt("BACKEND_PORT", 8080);
+    settings.listenBacklog = getInt("SERVER_LISTEN_BACKLOG", 1024);
+    settings.acceptShards = getSize("SERVER_ACCEPT_SHARDS", 0); // 0 = one per core
+    settings.keepAliveTimeout = getInt("SERVER_KEEPALIVE_TIMEOUT", 15); // seconds
+    settings.keepAliveMaxRequests = getSize("SERVER_KEEPALIVE_MAX_REQUESTS", 1000);
+    settings.ioUring = getBool("SERVER_IO_URING", true); // Falls back to recv/pwrite when unavailable
+    settings.maxConcurrentUploads = getSize("MAX_CONCURRENT_UPLOADS", 10);
+    settings.uploadMemoryBudget = getSize("UPLOAD_MEMORY_BUDGET", 268435456); // 256MB default
+    settings.uploadRetryAfter = getInt("UPLOAD_RETRY_AFTER", 5); // seconds, sent with 503
+
+    settings.storageDirectory = getString("STORAGE_DIRECTORY", "./uploads/");
+    // Ensure directory ends with slash
+    if (!settings.storageDirectory.empty() && settings.storageDirectory.back() != '/') {
+        settings.storageDirectory += '/';
+    }
+    settings.maxFileSize = getSize("STORAGE_MAX_FILE_SIZE", 104857600); // 100MB default
+    settings.chunkSize = getSize("STORAGE_CHUNK_SIZE", 65536); // 64KB default
+    // Chunks are hash tree leaves, which only come in this range
+    if (settings.chunkSize < MerkleHasher::MIN_LEAF_SIZE || settings.chunkSize > MerkleHasher::MAX_LEAF_SIZE) {
+        logError("STORAGE_CHUNK_SIZE out of range: " + std::to_string(settings.chunkSize) + ". Using 65536.");
+        settings.chunkSize = 65536;
+    }
+    settings.maxUploadSessions = getSize("STORAGE_MAX_SESSIONS", 64);
+    settings.dedup = getBool("STORAGE_DEDUP", false);
+    settings.durable = getBool("STORAGE_DURABLE", false);
+    settings.directIo = getBool("STORAGE_DIRECT_IO", false);
+    settings.pipeline = getBool("STORAGE_PIPELINE", true);
+    settings.conflictPolicy = getString("STORAGE_CONFLICT_POLICY", "overwrite");
+
+    settings.fileVerification = getBool("ENABLE_FILE_VERIFICATION", true);
+    settings.progressTracking = getBool("ENABLE_PROGRESS_TRACKING", true);
+    settings.logLevel = getString("LOG_LEVEL", "INFO");
+}
+
 void ConfigManager::logInfo(const std::string& message) const
 {
     std::cout << COLOR_BLUE << "[Config] " << message << COLOR_RESET << std::endl;
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <map>
+#include <memory>
 #include <fstream>
 #include <sstream>
 
@@ -13,8 +14,18 @@ public:
     explicit ConfigManager(const std::string& configFile);
     ~ConfigManager();
 
+    // The configuration in effect. It is parsed once and replaced whole by
+    // reload(), so a reader sees one consistent version for as long as it
+    // holds the pointer, and no request reads the file
+    static std::shared_ptr<const ConfigManager> current();
+    // Re-reads the config file and publishes it; a file that cannot be
+    // read leaves the current configuration in place
+    static bool reload();
+
     // Load configuration from file
     bool loadConfig(const std::string& configFile = "config.env");
+    bool isLoaded() const;
+    const std::string& getConfigFile() const;
     
     // Get configuration values
     std::string getString(const std::string& key, const std::string& defaultValue = "") const;
@@ -37,21 +48,65 @@ public:
     // Server configuration getters
     int getFrontendPort() const;
     int getBackendPort() const;
+    int getListenBacklog() const;
+    size_t getAcceptShards() const;
+    int getKeepAliveTimeout() const;
+    size_t getKeepAliveMaxRequests() const;
+    bool isIoUringEnabled() const;
+    size_t getMaxConcurrentUploads() const;
+    size_t getUploadMemoryBudget() const;
+    int getUploadRetryAfter() const;
     std::string getStorageDirectory() const;
     size_t getMaxFileSize() const;
     size_t getChunkSize() const;
+    size_t getMaxUploadSessions() const;
+    bool isDedupEnabled() const;
+    bool isDurableEnabled() const;
+    bool isDirectIoEnabled() const;
+    bool isPipelineEnabled() const;
+    std::string getConflictPolicy() const;
     bool isFileVerificationEnabled() const;
     bool isProgressTrackingEnabled() const;
     std::string getLogLevel() const;
 
 private:
+    // The typed values, parsed and checked once per load so requests
+    // neither parse nor log them again
+    struct Settings {
+        int frontendPort;
+        int backendPort;
+        int listenBacklog;
+        size_t acceptShards;
+        int keepAliveTimeout;
+        size_t keepAliveMaxRequests;
+        bool ioUring;
+        size_t maxConcurrentUploads;
+        size_t uploadMemoryBudget;
+        int uploadRetryAfter;
+        std::string storageDirectory;
+        size_t maxFileSize;
+        size_t chunkSize;
+        size_t maxUploadSessions;
+        bool dedup;
+        bool durable;
+        bool directIo;
+        bool pipeline;
+        std::string conflictPolicy;
+        bool fileVerification;
+        bool progressTracking;
+        std::string logLevel;
+    };
+
     std::map<std::string, std::string> config;
+    Settings settings;
     std::string configFilePath;
+    bool loaded;
     
     // Helper functions
     std::string trim(const std::string& str) const;
     bool parseLine(const std::string& line, std::string& key, std::string& value) const;
     void setDefaults();
+    void parseSettings();
     void logInfo(const std::string& message) const;
     void logError(const std::string& message) const;
 };
@@ -0,0 +1,131 @@
+#include "ConfigWatcher.hpp"
+#include "ConfigManager.hpp"
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include <unistd.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+static const int POLL_INTERVAL_MS = 500; // How soon SIGHUP and stop() are noticed
+static const int SETTLE_DELAY_MS = 100;  // Editors and deploy tools often write a file in several steps
+
+static std::atomic<bool> reloadRequested(false);
+
+#ifdef __linux__
+// Drains the queued events; true if any of them touched filename
+static bool readEvents(int inotifyFd, const std::string& filename)
+{
+    alignas(struct inotify_event) char buffer[4096];
+    bool touched = false;
+    ssize_t length;
+    while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+        for (char* position = buffer; position < buffer + length;) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(position);
+            if (event->len > 0 && filename == event->name) {
+                touched = true;
+            }
+            position += sizeof(struct inotify_event) + event->len;
+        }
+    }
+    return touched;
+}
+#endif
+
+// ----------------------------- Constructor/Destructor --------------------------------->
+
+ConfigWatcher::ConfigWatcher(std::function<void(const ConfigManager&)> onReload)
+    : onReload(std::move(onReload)), running(false)
+{
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+    stop();
+}
+
+// ----------------------------- Control --------------------------------->
+
+void ConfigWatcher::start()
+{
+    if (running.exchange(true)) {
+        return;
+    }
+    thread = std::thread(&ConfigWatcher::run, this);
+}
+
+void ConfigWatcher::stop()
+{
+    running = false;
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void ConfigWatcher::requestReload()
+{
+    reloadRequested.store(true, std::memory_order_relaxed);
+}
+
+// ----------------------------- Watching --------------------------------->
+
+void ConfigWatcher::run()
+{
+    std::error_code error;
+    std::filesystem::path configFile = std::filesystem::absolute(ConfigManager::current()->getConfigFile(), error);
+    std::string filename = configFile.filename().string();
+
+    int inotifyFd = -1;
+#ifdef __linux__
+    // The directory is watched rather than the file, so a file replaced
+    // by a rename is still seen
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd >= 0 &&
+        inotify_add_watch(inotifyFd, configFile.parent_path().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+#endif
+
+    while (running) {
+        bool changed = false;
+#ifdef __linux__
+        if (inotifyFd >= 0) {
+            struct pollfd pollFd = {inotifyFd, POLLIN, 0};
+            if (poll(&pollFd, 1, POLL_INTERVAL_MS) > 0 && readEvents(inotifyFd, filename)) {
+                // Let the writer finish, and take its remaining events with this change
+                std::this_thread::sleep_for(std::chrono::milliseconds(SETTLE_DELAY_MS));
+                readEvents(inotifyFd, filename);
+                changed = true;
+            }
+        } else
+#endif
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+        }
+
+        if (reloadRequested.exchange(false) || changed) {
+            reload();
+        }
+    }
+
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
+    }
+}
+
+void ConfigWatcher::reload()
+{
+    if (!ConfigManager::reload()) {
+        return;
+    }
+    std::shared_ptr<const ConfigManager> config = ConfigManager::current();
+    if (onReload) {
+        onReload(*config);
+    }
+}
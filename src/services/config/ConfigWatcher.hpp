@@ -0,0 +1,38 @@
+#ifndef CONFIG_WATCHER_HPP
+#define CONFIG_WATCHER_HPP
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+class ConfigManager;
+
+// Reloads the configuration when its file changes (watched with inotify
+// where there is one) or when the process gets SIGHUP, then hands the new
+// snapshot to the owner. Whatever requests read follows at once; settings
+// the listeners took when they started keep until they start again.
+class ConfigWatcher
+{
+public:
+    explicit ConfigWatcher(std::function<void(const ConfigManager&)> onReload);
+    ~ConfigWatcher();
+
+    ConfigWatcher(const ConfigWatcher&) = delete;
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+    void start();
+    void stop();
+
+    // Only sets a flag, so a signal handler may call it
+    static void requestReload();
+
+private:
+    std::function<void(const ConfigManager&)> onReload;
+    std::thread thread;
+    std::atomic<bool> running;
+
+    void run();
+    void reload();
+};
+
+#endif // CONFIG_WATCHER_HPP
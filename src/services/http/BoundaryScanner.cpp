@@ -0,0 +1,146 @@
+#include "BoundaryScanner.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define RAPIDCOMM_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+// ----------------------------- Scan Variants --------------------------------->
+
+static size_t findScalar(const char *data, size_t length, const char *needle, size_t needleLength)
+{
+    if (needleLength == 0 || length < needleLength) {
+        return BoundaryScanner::npos;
+    }
+
+    const char *end = data + length - needleLength + 1;
+    const char *cursor = data;
+    while (cursor < end) {
+        cursor = static_cast<const char *>(memchr(cursor, needle[0], end - cursor));
+        if (!cursor) {
+            return BoundaryScanner::npos;
+        }
+        if (memcmp(cursor + 1, needle + 1, needleLength - 1) == 0) {
+            return cursor - data;
+        }
+        cursor++;
+    }
+    return BoundaryScanner::npos;
+}
+
+#ifdef RAPIDCOMM_X86_SIMD
+
+// SSE2 is part of the x86-64 baseline, so this needs no dispatch
+__attribute__((target("sse2")))
+static size_t findSse2(const char *data, size_t length, const char *needle, size_t needleLength)
+{
+    if (needleLength < 2 || length < needleLength) {
+        return findScalar(data, length, needle, needleLength);
+    }
+
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needleLength - 1]);
+
+    size_t i = 0;
+    for (; i + needleLength - 1 + 16 <= length; i += 16) {
+        __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + needleLength - 1));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last))));
+
+        while (mask != 0) {
+            size_t candidate = i + __builtin_ctz(mask);
+            if (memcmp(data + candidate + 1, needle + 1, needleLength - 2) == 0) {
+                return candidate;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    size_t rest = findScalar(data + i, length - i, needle, needleLength);
+    return rest == BoundaryScanner::npos ? rest : i + rest;
+}
+
+__attribute__((target("avx2")))
+static size_t findAvx2(const char *data, size_t length, const char *needle, size_t needleLength)
+{
+    if (needleLength < 2 || length < needleLength) {
+        return findScalar(data, length, needle, needleLength);
+    }
+
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needleLength - 1]);
+
+    size_t i = 0;
+    for (; i + needleLength - 1 + 32 <= length; i += 32) {
+        __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + needleLength - 1));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first), _mm256_cmpeq_epi8(blockLast, last))));
+
+        while (mask != 0) {
+            size_t candidate = i + __builtin_ctz(mask);
+            if (memcmp(data + candidate + 1, needle + 1, needleLength - 2) == 0) {
+                return candidate;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    size_t rest = findSse2(data + i, length - i, needle, needleLength);
+    return rest == BoundaryScanner::npos ? rest : i + rest;
+}
+
+#endif
+
+// ----------------------------- Dispatch --------------------------------->
+
+struct ScanVariant {
+    BoundaryScanner::ScanFunction function;
+    const char *name;
+};
+
+static const ScanVariant &getScanVariant()
+{
+    static const ScanVariant variant = []() -> ScanVariant {
+#ifdef RAPIDCOMM_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return {findAvx2, "avx2"};
+        }
+        return {findSse2, "sse2"};
+#else
+        return {findScalar, "scalar"};
+#endif
+    }();
+    return variant;
+}
+
+// ----------------------------- BoundaryScanner --------------------------------->
+
+BoundaryScanner::BoundaryScanner(const std::string &delimiter)
+    : delimiter(delimiter),
+      scan(getScanVariant().function)
+{
+}
+
+size_t BoundaryScanner::find(const char *data, size_t length) const
+{
+    return scan(data, length, delimiter.data(), delimiter.size());
+}
+
+size_t BoundaryScanner::partialMatchAtEnd(const char *data, size_t length) const
+{
+    size_t held = std::min(length, delimiter.size() - 1);
+    while (held > 0 && memcmp(data + length - held, delimiter.data(), held) != 0) {
+        held--;
+    }
+    return held;
+}
+
+const char *BoundaryScanner::implementationName()
+{
+    return getScanVariant().name;
+}
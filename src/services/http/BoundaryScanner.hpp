@@ -0,0 +1,35 @@
+#ifndef BOUNDARY_SCANNER_HPP
+#define BOUNDARY_SCANNER_HPP
+
+#include <cstddef>
+#include <string>
+
+// Finds a multipart delimiter in a byte buffer. On x86 the first and last
+// delimiter bytes are compared against 16 (SSE2) or 32 (AVX2) positions at
+// once and only positions where both match are verified in full; other
+// targets use a memchr-driven scalar scan. The best variant is picked once
+// at startup from the CPU's features.
+class BoundaryScanner
+{
+public:
+    static const size_t npos = static_cast<size_t>(-1);
+
+    explicit BoundaryScanner(const std::string &delimiter);
+
+    // Offset of the first complete delimiter, or npos
+    size_t find(const char *data, size_t length) const;
+
+    // Longest tail of data that is a proper prefix of the delimiter, i.e.
+    // how much to carry into the next chunk so a split match is not missed
+    size_t partialMatchAtEnd(const char *data, size_t length) const;
+
+    static const char *implementationName();
+
+    using ScanFunction = size_t (*)(const char *data, size_t length, const char *needle, size_t needleLength);
+
+private:
+    std::string delimiter;
+    ScanFunction scan;
+};
+
+#endif // BOUNDARY_SCANNER_HPP
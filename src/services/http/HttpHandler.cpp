@@ -1,11 +1,19 @@
 #include "HttpHandler.hpp"
 #include "../storage/StorageService.hpp"
+#include "../storage/UploadWriter.hpp"
+#include "../storage/FileReceiver.hpp"
+#include "../storage/UploadSession.hpp"
 #include "../config/ConfigManager.hpp"
+#include "../server/UploadGovernor.hpp"
+#include "MultipartParser.hpp"
+#include "RequestParser.hpp"
 
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <algorithm>
+#include <atomic>
+#include <memory>
 
 #include <unistd.h>
 #include <cstring>
@@ -21,19 +29,73 @@
 #define COLOR_CYAN    "\033[0;36m"
 #define COLOR_RESET   "\033[0m"
 
+static const size_t MAX_FORM_FIELD_SIZE = 64 * 1024; // Text fields next to the file part
+static const size_t MULTIPART_ENVELOPE_SIZE = 4 * MAX_FORM_FIELD_SIZE; // Boundaries, part headers and text fields
+static const char SESSIONS_ROUTE[] = "/upload/sessions";
+static const size_t SESSIONS_ROUTE_LENGTH = sizeof(SESSIONS_ROUTE) - 1;
+static const char EXISTING_ROUTE[] = "/upload/existing";
+static const size_t MAX_BUFFERED_BODY_SIZE = 1024 * 1024; // parseRequest keeps the whole body in memory
+static const char NAME_TAKEN_MESSAGE[] = "A file with this name already exists";
+static const char LATE_HASH_MESSAGE[] = "originalHash must be sent before the file field";
+
+// A storage service set up from one configuration snapshot
+struct StorageTemplate
+{
+    std::shared_ptr<const ConfigManager> config;
+    StorageService storage;
+
+    explicit StorageTemplate(const std::shared_ptr<const ConfigManager> &config)
+        : config(config), storage(config->getStorageDirectory())
+    {
+        storage.setMaxFileSize(config->getMaxFileSize());
+        storage.setChunkSize(config->getChunkSize());
+        storage.setMaxSessions(config->getMaxUploadSessions());
+        storage.setIoUringEnabled(config->isIoUringEnabled());
+        storage.setDedupEnabled(config->isDedupEnabled());
+        storage.setDurable(config->isDurableEnabled());
+        storage.setDirectIo(config->isDirectIoEnabled());
+        storage.setPipelineEnabled(config->isPipelineEnabled());
+        storage.setConflictPolicy(config->getConflictPolicy());
+    }
+};
+
+// Set up (and the storage directory checked) once per snapshot; each
+// request takes a copy, since a save records the name it used
+static StorageService getStorage(const std::shared_ptr<const ConfigManager> &config)
+{
+    static std::shared_ptr<const StorageTemplate> cached;
+    std::shared_ptr<const StorageTemplate> current = std::atomic_load(&cached);
+    if (!current || current->config != config) {
+        current = std::make_shared<const StorageTemplate>(config);
+        std::atomic_store(&cached, current);
+    }
+    return current->storage;
+}
+
 // ----------------------------- Constructor --------------------------------->
 
 HttpHandler::HttpHandler(int clientSocket, bool isFrontend) 
-    : clientSocket(clientSocket), isFrontend(isFrontend) {}
+    : clientSocket(clientSocket), isFrontend(isFrontend), responseBuffer(nullptr), keepAlive(false) {}
+
+HttpHandler::HttpHandler(std::string &responseBuffer, bool isFrontend, bool keepAlive)
+    : clientSocket(-1), isFrontend(isFrontend), responseBuffer(&responseBuffer), keepAlive(keepAlive) {}
 
 // ----------------------------- Handle request ------------------------------->
 
 void HttpHandler::handleRequest()
 {
-    std::string request = parseRequest();
+    handleRequest(parseRequest());
+}
 
-    std::string method = extractMethod(request);
-    std::string route = extractRoute(request);
+void HttpHandler::handleRequest(const std::string &request)
+{
+    RequestHead head;
+    if (RequestParser::parse(request, head) != RequestParser::Result::Complete) {
+        sendErrorResponse(400, "Malformed request");
+        return;
+    }
+    std::string method(head.method);
+    std::string route(head.target);
     
     std::string serverColor = isFrontend ? COLOR_BLUE : COLOR_YELLOW;
     std::cout << serverColor << "[" << (isFrontend ? "Frontend" : "Backend") << "] " << method << " " << route << COLOR_RESET << std::endl;
@@ -46,17 +108,27 @@ void HttpHandler::handleRequest()
     
     // Frontend server - serve static files
     if (isFrontend) {
-        std::string response = "HTTP/1.1 200 OK\r\n";
+        std::string body = handleRoute(route);
+        std::string scratch;
+        std::string &response = responseTarget(scratch);
+        response += "HTTP/1.1 200 OK\r\n";
         response += "Content-Type: text/html\r\n";
-        response += "Connection: close\r\n\r\n";
-        response += handleRoute(route);
+        response += "Content-Length: ";
+        response += std::to_string(body.length());
+        response += "\r\n";
+        response += connectionHeader();
+        response += body;
         
-        send(clientSocket, response.c_str(), response.length(), 0);
+        sendBuilt(response);
     }
     // Backend server - handle API requests
     else {
         if (method == "POST" && route == "/upload") {
-            handleFileUpload(request);
+            handleFileUpload(request, head);
+        } else if (method == "POST" && route.substr(0, route.find('?')) == EXISTING_ROUTE) {
+            handleExistingUpload(route, head);
+        } else if (route.compare(0, SESSIONS_ROUTE_LENGTH, SESSIONS_ROUTE) == 0) {
+            handleSessionRequest(method, route, head);
         } else {
             sendErrorResponse(404, "Endpoint not found");
         }
@@ -82,7 +154,7 @@ std::string HttpHandler::parseRequest()
         }
         
         request.append(buffer, bytesRead);
-        headerEnd = request.find("\r\n\r\n");
+        headerEnd = RequestParser::findHeaderEnd(request, request.size() - bytesRead);
         
         // Prevent infinite loop with very large headers
         if (request.size() > 1024 * 1024) { // 1MB header limit
@@ -91,31 +163,28 @@ std::string HttpHandler::parseRequest()
         }
     }
     
-    // Parse Content-Length from headers
-    size_t contentLengthPos = request.find("Content-Length:");
-    if (contentLengthPos == std::string::npos) {
-        contentLengthPos = request.find("content-length:");
+    RequestHead head;
+    if (RequestParser::parse(request, head) != RequestParser::Result::Complete) {
+        std::cerr << COLOR_RED << "[Backend] Malformed request head!" << COLOR_RESET << std::endl;
+        return "";
     }
     
     size_t totalContentLength = 0;
-    if (contentLengthPos != std::string::npos) {
-        size_t valueStart = request.find(":", contentLengthPos) + 1;
-        size_t valueEnd = request.find("\r\n", valueStart);
-        if (valueEnd != std::string::npos) {
-            std::string lengthStr = request.substr(valueStart, valueEnd - valueStart);
-            // Trim whitespace
-            lengthStr.erase(0, lengthStr.find_first_not_of(" \t"));
-            lengthStr.erase(lengthStr.find_last_not_of(" \t") + 1);
-            totalContentLength = std::stoull(lengthStr);
-            
-            std::cout << COLOR_YELLOW << "[Backend] Content-Length: " << totalContentLength << " bytes" << COLOR_RESET << std::endl;
+    if (head.has(HttpHeader::ContentLength)) {
+        if (!RequestParser::parseContentLength(head.get(HttpHeader::ContentLength), totalContentLength)) {
+            std::cerr << COLOR_RED << "[Backend] Invalid Content-Length header!" << COLOR_RESET << std::endl;
+            return "";
         }
+        std::cout << COLOR_YELLOW << "[Backend] Content-Length: " << totalContentLength << " bytes" << COLOR_RESET << std::endl;
+    }
+    if (totalContentLength > MAX_BUFFERED_BODY_SIZE) {
+        std::cerr << COLOR_RED << "[Backend] Request body too large!" << COLOR_RESET << std::endl;
+        return "";
     }
     
     // Calculate how much body we still need to read
-    size_t headersSize = headerEnd + 4; // +4 for \r\n\r\n
-    size_t bodyAlreadyRead = request.size() - headersSize;
-    size_t bodyStillNeeded = totalContentLength - bodyAlreadyRead;
+    size_t bodyAlreadyRead = request.size() - head.size;
+    size_t bodyStillNeeded = totalContentLength > bodyAlreadyRead ? totalContentLength - bodyAlreadyRead : 0;
     
     // Clean HTTP processing without verbose output
     
@@ -156,32 +225,6 @@ std::string HttpHandler::handleRoute(std::string input)
     return content;
 }
 
-std::string HttpHandler::extractRoute(const std::string &request)
-{
-    std::stringstream ss(request);
-
-    std::string requestLine;
-    std::getline(ss, requestLine);
-
-    size_t methodEnd = requestLine.find(" ");
-    size_t routeStart = methodEnd + 1;
-    size_t routeEnd = requestLine.find(" ", routeStart);
-
-    std::string route = requestLine.substr(routeStart, routeEnd - routeStart);
-
-    return route;
-}
-
-std::string HttpHandler::extractMethod(const std::string &request)
-{
-    std::stringstream ss(request);
-    std::string requestLine;
-    std::getline(ss, requestLine);
-    
-    size_t methodEnd = requestLine.find(" ");
-    return requestLine.substr(0, methodEnd);
-}
-
 std::string HttpHandler::getHtmlContent(const std::string &route)
 {
     std::ifstream file(route);
@@ -285,46 +328,66 @@ std::string HttpHandler::determineFileType(const std::string &extension)
     return "file";
 }
 
-void HttpHandler::handleFileUpload(const std::string &request)
+void HttpHandler::handleFileUpload(const std::string &request, const RequestHead &head)
 {
     std::string filename;
-    std::vector<char> fileData;
+    std::string_view fileData; // Points into request, which is the only copy of the upload
     std::string originalHash;
     std::string originalSize;
     std::string timestamp;
     
-    std::string result = parseMultipartData(request, filename, fileData, originalHash, originalSize, timestamp);
+    // The body was already counted against the memory budget by the connection that buffered it
+    UploadGovernor::Ticket ticket = UploadGovernor::instance().admitUpload(0);
+    if (!ticket.isValid()) {
+        std::cout << COLOR_RED << "[Backend] ❌ Upload refused: server busy" << COLOR_RESET << std::endl;
+        sendBusyResponse(UploadGovernor::instance().getRetryAfter());
+        return;
+    }
+
+    std::string result = parseMultipartData(request, head, filename, fileData, originalHash, originalSize, timestamp);
     
     if (result == "success") {
         // Log file upload info
         std::cout << COLOR_BLUE << "[Backend] Uploading: " << filename << COLOR_RESET << std::endl;
         // Determine file type for appropriate handling
-        std::string fileExtension = "";
-        size_t dotPos = filename.find_last_of('.');
-        if (dotPos != std::string::npos) {
-            fileExtension = filename.substr(dotPos + 1);
-            std::transform(fileExtension.begin(), fileExtension.end(), fileExtension.begin(), ::tolower);
-        }
+        std::string fileType = getFileTypeFromName(filename);
         
-        std::string fileType = determineFileType(fileExtension);
+        std::string integrityError = checkDeclaredSize(originalSize, fileData.size());
+        if (integrityError.empty()) {
+            integrityError = IntegrityHasher::checkDeclared(originalHash);
+        }
+        if (!integrityError.empty()) {
+            std::cout << COLOR_RED << "[Backend] ❌ " << filename << ": " << integrityError << COLOR_RESET << std::endl;
+            sendErrorResponse(422, integrityError);
+            return;
+        }
         
         // Save file using storage service with config
-        ConfigManager config;
-        std::string storageDir = config.getStorageDirectory();
-        StorageService storage(storageDir);
-        auto saveSuccess = storage.saveFileWithVerification(filename, fileData);
+        std::shared_ptr<const ConfigManager> config = ConfigManager::current();
+        StorageService storage = getStorage(config);
+        if (storage.isNameTaken(filename)) {
+            std::cout << COLOR_RED << "[Backend] ❌ " << filename << ": name taken" << COLOR_RESET << std::endl;
+            sendErrorResponse(409, NAME_TAKEN_MESSAGE);
+            return;
+        }
+        size_t leafSize = config->getChunkSize();
+        IntegrityHasher::Algorithm algorithm = IntegrityHasher::negotiate(originalHash, fileData.size(), leafSize);
+        IntegrityHasher hasher(algorithm, leafSize);
+        hasher.expect(originalHash);
+        auto saveSuccess = storage.saveFileWithVerification(filename, fileData, hasher);
         
         if (saveSuccess.first) {
-            std::string message = (fileType == "video") ? "Video uploaded successfully" : 
-                                 (fileType == "audio") ? "Audio uploaded successfully" :
-                                 (fileType == "image") ? "Image uploaded successfully" :
-                                 (fileType == "document") ? "Document uploaded successfully" :
-                                 (fileType == "code") ? "Code file uploaded successfully" :
-                                 (fileType == "binary") ? "Binary file uploaded successfully" :
-                                 "File uploaded successfully";
-            std::cout << COLOR_GREEN << "[Backend] ✅ " << filename << COLOR_RESET << std::endl;
+            std::string message = getUploadMessage(fileType);
+            std::cout << COLOR_GREEN << "[Backend] ✅ " << storage.getStoredFilename() << COLOR_RESET << std::endl;
             
-            sendJsonResponse("{\"status\":\"success\",\"message\":\"" + message + "\",\"filename\":\"" + filename + "\",\"type\":\"" + fileType + "\",\"size\":" + std::to_string(fileData.size()) + "}");
+            sendJsonResponse("{\"status\":\"success\",\"message\":\"" + message + "\",\"filename\":\"" + escapeJson(storage.getStoredFilename()) + "\",\"type\":\"" + fileType + "\",\"size\":" + std::to_string(fileData.size()) + ",\"hash\":\"" + saveSuccess.second + "\"}");
+        } else if (hasher.verify() == IntegrityHasher::Verdict::Mismatch) {
+            std::cout << COLOR_RED << "[Backend] ❌ " << filename << ": hash mismatch" << COLOR_RESET << std::endl;
+            sendErrorResponse(422, "Hash mismatch: declared " + originalHash + ", computed " + hasher.finish());
+        } else if (storage.isNameTaken(filename)) {
+            // Another upload took the name while this one was being saved
+            std::cout << COLOR_RED << "[Backend] ❌ " << filename << ": name taken" << COLOR_RESET << std::endl;
+            sendErrorResponse(409, NAME_TAKEN_MESSAGE);
         } else {
             std::cout << COLOR_RED << "[Backend] ❌ " << filename << COLOR_RESET << std::endl;
             sendErrorResponse(500, "Failed to save " + fileType + " to storage - atomic operation failed");
@@ -335,160 +398,727 @@ void HttpHandler::handleFileUpload(const std::string &request)
     }
 }
 
-std::string HttpHandler::parseMultipartData(const std::string &request, std::string &filename, std::vector<char> &fileData, 
-                                           std::string &originalHash, std::string &originalSize, std::string &timestamp)
+bool HttpHandler::handleStreamedUpload(int socketFd, const std::string &request)
 {
-    // Parse headers to get content type and boundary
-    auto headers = parseHeaders(request);
-    
-    auto contentTypeIt = headers.find("content-type");
-    if (contentTypeIt == headers.end()) {
-        return "Missing Content-Type header";
+    RequestHead head;
+    if (RequestParser::parse(request, head) != RequestParser::Result::Complete) {
+        return rejectStreamedUpload(400, "Malformed request");
     }
-    
-    std::string boundary = getBoundary(contentTypeIt->second);
+    std::string method(head.method);
+    std::string route(head.target);
+    std::cout << COLOR_YELLOW << "[Backend] " << method << " " << route << COLOR_RESET << std::endl;
+
+    if (head.has(HttpHeader::Expect) && !RequestParser::equalsIgnoreCase(head.get(HttpHeader::Expect), "100-continue")) {
+        return rejectStreamedUpload(417, "Expectation not supported");
+    }
+    if (!isFrontend && method == "POST" && route == "/upload") {
+        return handleMultipartUpload(socketFd, request, head);
+    }
+    if (!isFrontend && method == "PUT" && route.compare(0, SESSIONS_ROUTE_LENGTH + 1, std::string(SESSIONS_ROUTE) + "/") == 0) {
+        return handleChunkUpload(socketFd, request, head, route);
+    }
+    if (!isFrontend && method == "PUT" && route.compare(0, 8, "/upload/") == 0) {
+        return handleRawUpload(socketFd, request, head, decodePathSegment(route.substr(8)));
+    }
+    return rejectStreamedUpload(404, "Endpoint not found");
+}
+
+bool HttpHandler::rejectStreamedUpload(int statusCode, const std::string &message)
+{
+    // Whatever is left of the body is still sitting in the socket
+    keepAlive = false;
+    sendErrorResponse(statusCode, message);
+    return false;
+}
+
+bool HttpHandler::admitStreamedBody(int socketFd, const RequestHead &head, const StorageService &storage, size_t incomingSize)
+{
+    // Decided on the headers alone, before the body is read (or, with
+    // Expect: 100-continue, before the client even sends it)
+    auto capacity = storage.checkCapacity(incomingSize);
+    if (!capacity.first) {
+        std::cout << COLOR_RED << "[Backend] ❌ Upload refused: " << capacity.second << COLOR_RESET << std::endl;
+        return rejectStreamedUpload(413, capacity.second);
+    }
+
+    if (head.has(HttpHeader::Expect)) {
+        static const char CONTINUE[] = "HTTP/1.1 100 Continue\r\n\r\n";
+        send(socketFd, CONTINUE, sizeof(CONTINUE) - 1, 0);
+    }
+    return true;
+}
+
+bool HttpHandler::handleRawUpload(int socketFd, const std::string &request, const RequestHead &head, const std::string &filename)
+{
+    if (filename.empty()) {
+        return rejectStreamedUpload(400, "Invalid filename");
+    }
+
+    size_t fileSize = 0;
+    RequestParser::parseContentLength(head.get(HttpHeader::ContentLength), fileSize);
+    std::string_view bodyPrefix = head.body(request);
+
+    std::cout << COLOR_BLUE << "[Backend] Uploading: " << filename << COLOR_RESET << std::endl;
+    std::string fileType = getFileTypeFromName(filename);
+
+    std::shared_ptr<const ConfigManager> config = ConfigManager::current();
+    StorageService storage = getStorage(config);
+    if (storage.isNameTaken(filename)) {
+        return rejectStreamedUpload(409, NAME_TAKEN_MESSAGE);
+    }
+    // Raw bodies have no form fields, so the client's hash comes in a header
+    std::string_view originalHash = head.get(HttpHeader::OriginalHash);
+    std::string hashError = IntegrityHasher::checkDeclared(originalHash);
+    if (!hashError.empty()) {
+        return rejectStreamedUpload(422, hashError);
+    }
+    if (!admitStreamedBody(socketFd, head, storage, fileSize)) {
+        return false;
+    }
+
+    size_t leafSize = config->getChunkSize();
+    IntegrityHasher::Algorithm algorithm = IntegrityHasher::negotiate(originalHash, fileSize, leafSize);
+    IntegrityHasher hasher(algorithm, leafSize);
+    hasher.expect(originalHash);
+    auto saved = storage.saveStreamedFile(filename, socketFd, bodyPrefix, fileSize, hasher);
+    if (!saved.first) {
+        std::cout << COLOR_RED << "[Backend] ❌ " << filename << COLOR_RESET << std::endl;
+        if (hasher.verify() == IntegrityHasher::Verdict::Mismatch) {
+            return rejectStreamedUpload(422, "Hash mismatch: declared " + hasher.getExpected() + ", computed " + hasher.finish());
+        }
+        if (storage.isNameTaken(filename)) {
+            return rejectStreamedUpload(409, NAME_TAKEN_MESSAGE);
+        }
+        return rejectStreamedUpload(500, "Failed to save " + fileType + " to storage");
+    }
+
+    std::cout << COLOR_GREEN << "[Backend] ✅ " << storage.getStoredFilename() << COLOR_RESET << std::endl;
+    sendJsonResponse("{\"status\":\"success\",\"message\":\"" + getUploadMessage(fileType) + "\",\"filename\":\"" + escapeJson(storage.getStoredFilename()) + "\",\"type\":\"" + fileType + "\",\"size\":" + std::to_string(fileSize) + ",\"hash\":\"" + saved.second + "\"}");
+    return true;
+}
+
+bool HttpHandler::handleMultipartUpload(int socketFd, const std::string &request, const RequestHead &head)
+{
+    std::string boundary = getBoundary(head.get(HttpHeader::ContentType));
     if (boundary.empty()) {
-        return "Invalid multipart boundary";
+        return rejectStreamedUpload(400, "Invalid multipart boundary");
     }
-    
-    // Get request body
-    std::string body = getRequestBody(request);
-    
-    // Find file data in multipart body
-    std::string boundaryDelim = "--" + boundary;
-    
-    // Look for file form field (try different variations)
-    size_t fileStart = std::string::npos;
-    std::vector<std::string> fieldPatterns = {
-        "Content-Disposition: form-data; name=\"file\"",
-        "content-disposition: form-data; name=\"file\"",
-        "Content-Disposition: form-data; name=file",
-        "content-disposition: form-data; name=file"
-    };
-    
-    for (const auto& pattern : fieldPatterns) {
-        fileStart = body.find(pattern);
-        if (fileStart != std::string::npos) {
-            break;
+    size_t contentLength = 0;
+    RequestParser::parseContentLength(head.get(HttpHeader::ContentLength), contentLength);
+    std::string_view bodyPrefix = head.body(request);
+
+    std::shared_ptr<const ConfigManager> config = ConfigManager::current();
+    StorageService storage = getStorage(config);
+    size_t fileSizeEstimate = contentLength > MULTIPART_ENVELOPE_SIZE ? contentLength - MULTIPART_ENVELOPE_SIZE : 0;
+    if (!admitStreamedBody(socketFd, head, storage, fileSizeEstimate)) {
+        return false;
+    }
+
+    // Only the file part touches disk; the small text fields stay in memory
+    std::unique_ptr<UploadWriter> writer;
+    IntegrityHasher hasher;
+    std::string filename;
+    std::string fieldName;
+    std::string fieldValue;
+    std::string originalHash;
+    std::string originalSize;
+    std::string timestamp;
+    std::string integrityError;
+    size_t declaredSize = 0;
+    bool sizeDeclared = false;
+    bool inFilePart = false;
+    bool storageFailed = false;
+    bool nameTaken = false;
+    bool hashAfterFile = false;
+
+    MultipartParser parser(boundary);
+    parser.onPartBegin([&](const std::string &partHeaders) {
+        fieldName = MultipartParser::getDispositionParam(partHeaders, "name");
+        fieldValue.clear();
+        inFilePart = fieldName == "file";
+        if (!inFilePart) {
+            return true;
+        }
+        filename = MultipartParser::getDispositionParam(partHeaders, "filename");
+        if (writer || filename.empty()) {
+            return false;
+        }
+        nameTaken = storage.isNameTaken(filename);
+        if (nameTaken) {
+            return false;
+        }
+        integrityError = IntegrityHasher::checkDeclared(originalHash);
+        if (!integrityError.empty()) {
+            return false;
+        }
+        std::cout << COLOR_BLUE << "[Backend] Uploading: " << filename << COLOR_RESET << std::endl;
+        writer = storage.beginUpload(filename, fileSizeEstimate);
+        storageFailed = !writer;
+        // Only fields sent ahead of the file can pick the algorithm
+        size_t leafSize = config->getChunkSize();
+        IntegrityHasher::Algorithm algorithm = IntegrityHasher::negotiate(originalHash, fileSizeEstimate, leafSize);
+        hasher = IntegrityHasher(algorithm, leafSize);
+        return !storageFailed;
+    });
+    parser.onPartData([&](const char *data, size_t length) {
+        if (inFilePart) {
+            if (sizeDeclared && writer->getSize() + length > declaredSize) {
+                integrityError = checkDeclaredSize(originalSize, writer->getSize() + length);
+                return false;
+            }
+            hasher.update(data, length);
+            storageFailed = !writer->write(data, length);
+            return !storageFailed;
+        }
+        fieldValue.append(data, length);
+        return fieldValue.size() <= MAX_FORM_FIELD_SIZE;
+    });
+    parser.onPartEnd([&]() {
+        if (inFilePart) {
+            // Whatever the client declared ahead of the file is settled here,
+            // before the rest of the body is read
+            integrityError = checkDeclaredIntegrity(hasher, originalHash, originalSize, writer->getSize());
+            return integrityError.empty();
+        }
+        if (fieldName == "originalHash") {
+            // The file is already hashed by the time it arrives, maybe in another format
+            hashAfterFile = writer != nullptr;
+            originalHash = fieldValue;
+            return !hashAfterFile;
+        }
+        if (fieldName == "originalSize") {
+            originalSize = fieldValue;
+            sizeDeclared = RequestParser::parseContentLength(originalSize, declaredSize);
+        }
+        else if (fieldName == "timestamp") timestamp = fieldValue;
+        return true;
+    });
+
+    // Body bytes go to the parser as they arrive; nothing is buffered whole
+    size_t prefixSize = std::min(bodyPrefix.size(), contentLength);
+    bool parsed = parser.feed(bodyPrefix.data(), prefixSize);
+    bool received = true;
+    if (parsed && prefixSize < contentLength) {
+        // Parsing, hashing and writing run on the pipeline's thread, if there is one
+        FileReceiver receiver(false);
+        receiver.setPipelined(config->isPipelineEnabled());
+        received = receiver.receive(socketFd, contentLength - prefixSize, [&](const char *data, size_t length) {
+            return parser.feed(data, length);
+        });
+        parsed = parser.getError().empty();
+        if (!received && parsed) {
+            std::cout << COLOR_RED << "[Backend] ❌ Upload interrupted: " << receiver.getLastError() << COLOR_RESET << std::endl;
+            return rejectStreamedUpload(400, "Upload interrupted");
         }
     }
-    
-    if (fileStart == std::string::npos) {
-        return "File field not found";
+
+    if (hashAfterFile) {
+        std::cout << COLOR_RED << "[Backend] ❌ " << filename << ": hash sent after the file" << COLOR_RESET << std::endl;
+        return rejectStreamedUpload(400, LATE_HASH_MESSAGE);
     }
-    
-    // Extract filename
-    size_t filenameStart = body.find("filename=\"", fileStart);
-    if (filenameStart == std::string::npos) {
-        filenameStart = body.find("filename=", fileStart);
-        if (filenameStart != std::string::npos) {
-            filenameStart += 9; // Length of "filename="
-            size_t filenameEnd = body.find_first_of(" \r\n", filenameStart);
-            if (filenameEnd != std::string::npos) {
-                filename = body.substr(filenameStart, filenameEnd - filenameStart);
+    if (integrityError.empty() && writer && parser.isComplete()) {
+        // A size that came after the file
+        integrityError = checkDeclaredIntegrity(hasher, originalHash, originalSize, writer->getSize());
+    }
+    if (!integrityError.empty()) {
+        std::cout << COLOR_RED << "[Backend] ❌ " << filename << ": " << integrityError << COLOR_RESET << std::endl;
+        return rejectStreamedUpload(422, integrityError);
+    }
+    if (nameTaken) {
+        std::cout << COLOR_RED << "[Backend] ❌ " << filename << ": name taken" << COLOR_RESET << std::endl;
+        return rejectStreamedUpload(409, NAME_TAKEN_MESSAGE);
+    }
+    if (storageFailed) {
+        std::cout << COLOR_RED << "[Backend] ❌ " << filename << COLOR_RESET << std::endl;
+        return rejectStreamedUpload(500, "Failed to save " + getFileTypeFromName(filename) + " to storage");
+    }
+    if (!parsed || !parser.isComplete()) {
+        std::string error = parsed ? "Incomplete multipart body" : parser.getError();
+        std::cout << COLOR_RED << "[Backend] ❌ Upload failed: " << error << COLOR_RESET << std::endl;
+        return rejectStreamedUpload(400, error);
+    }
+    if (!writer) {
+        return rejectStreamedUpload(400, "File field not found");
+    }
+    if (writer->getSize() == 0) {
+        return rejectStreamedUpload(400, "Invalid file size");
+    }
+
+    std::string fileType = getFileTypeFromName(filename);
+    size_t fileSize = writer->getSize();
+    if (!storage.finishUpload(*writer, hasher.finish())) {
+        std::cout << COLOR_RED << "[Backend] ❌ " << filename << COLOR_RESET << std::endl;
+        if (storage.isNameTaken(filename)) {
+            return rejectStreamedUpload(409, NAME_TAKEN_MESSAGE);
+        }
+        return rejectStreamedUpload(500, "Failed to save " + fileType + " to storage - atomic operation failed");
+    }
+
+    std::cout << COLOR_GREEN << "[Backend] ✅ " << storage.getStoredFilename() << COLOR_RESET << std::endl;
+    sendJsonResponse("{\"status\":\"success\",\"message\":\"" + getUploadMessage(fileType) + "\",\"filename\":\"" + escapeJson(storage.getStoredFilename()) + "\",\"type\":\"" + fileType + "\",\"size\":" + std::to_string(fileSize) + ",\"hash\":\"" + hasher.finish() + "\"}");
+    return true;
+}
+
+void HttpHandler::handleExistingUpload(const std::string &target, const RequestHead &head)
+{
+    std::string filename = decodePathSegment(getQueryParam(target, "filename"));
+    std::string hash(head.get(HttpHeader::OriginalHash));
+    size_t size = 0;
+    if (filename.empty() || hash.empty() || !RequestParser::parseContentLength(getQueryParam(target, "size"), size) || size == 0) {
+        sendErrorResponse(400, "A filename, a non-zero size and X-Original-Hash are required");
+        return;
+    }
+    std::string hashError = IntegrityHasher::checkDeclared(hash);
+    if (!hashError.empty()) {
+        sendErrorResponse(422, hashError);
+        return;
+    }
+
+    std::shared_ptr<const ConfigManager> config = ConfigManager::current();
+    StorageService storage = getStorage(config);
+    if (storage.isNameTaken(filename)) {
+        sendErrorResponse(409, NAME_TAKEN_MESSAGE);
+        return;
+    }
+    auto linked = storage.linkExistingFile(filename, size, hash);
+    if (!linked.first) {
+        sendErrorResponse(404, "Content not stored, send the file");
+        return;
+    }
+
+    std::string fileType = getFileTypeFromName(filename);
+    std::cout << COLOR_GREEN << "[Backend] ✅ " << storage.getStoredFilename() << " (already stored)" << COLOR_RESET << std::endl;
+    sendJsonResponse("{\"status\":\"success\",\"message\":\"" + getUploadMessage(fileType) + "\",\"filename\":\"" + escapeJson(storage.getStoredFilename()) + "\",\"type\":\"" + fileType + "\",\"size\":" + std::to_string(size) + ",\"hash\":\"" + linked.second + "\"}");
+}
+
+void HttpHandler::handleSessionRequest(const std::string &method, const std::string &target, const RequestHead &head)
+{
+    std::string path = target.substr(0, target.find('?'));
+    std::shared_ptr<const ConfigManager> config = ConfigManager::current();
+    StorageService storage = getStorage(config);
+
+    if (path == SESSIONS_ROUTE) {
+        if (method != "POST") {
+            sendErrorResponse(405, "Method not allowed");
+            return;
+        }
+        std::string filename = decodePathSegment(getQueryParam(target, "filename"));
+        size_t size = 0;
+        if (filename.empty() || !RequestParser::parseContentLength(getQueryParam(target, "size"), size) || size == 0) {
+            sendErrorResponse(400, "A filename and a non-zero size are required");
+            return;
+        }
+        std::string originalHash(head.get(HttpHeader::OriginalHash));
+        std::string hashError = IntegrityHasher::checkDeclared(originalHash);
+        if (!hashError.empty()) {
+            sendErrorResponse(422, hashError);
+            return;
+        }
+        if (!StorageService::isSessionHash(originalHash)) {
+            sendErrorResponse(400, "Upload sessions are checked as a hash tree: X-Original-Hash must be merkle-sha256:<leafSize>:<hex>");
+            return;
+        }
+        auto capacity = storage.checkCapacity(size);
+        if (!capacity.first) {
+            std::cout << COLOR_RED << "[Backend] ❌ Upload refused: " << capacity.second << COLOR_RESET << std::endl;
+            sendErrorResponse(413, capacity.second);
+            return;
+        }
+        if (storage.isNameTaken(filename)) {
+            sendErrorResponse(409, NAME_TAKEN_MESSAGE);
+            return;
+        }
+        auto room = storage.checkSessionCapacity();
+        if (!room.first) {
+            std::cout << COLOR_RED << "[Backend] ❌ Upload refused: " << room.second << COLOR_RESET << std::endl;
+            sendErrorResponse(429, room.second);
+            return;
+        }
+        std::shared_ptr<UploadSession> session = storage.createSession(filename, size, originalHash);
+        if (!session) {
+            sendErrorResponse(500, "Failed to create upload session");
+            return;
+        }
+        std::cout << COLOR_BLUE << "[Backend] Upload session " << session->getId() << ": " << filename << COLOR_RESET << std::endl;
+        sendJsonResponse(getSessionJson(*session));
+        return;
+    }
+
+    // /upload/sessions/<id>[/finalize]
+    std::string rest = path.size() > SESSIONS_ROUTE_LENGTH ? path.substr(SESSIONS_ROUTE_LENGTH + 1) : "";
+    size_t slash = rest.find('/');
+    std::string id = rest.substr(0, slash);
+    std::string action = slash == std::string::npos ? "" : rest.substr(slash + 1);
+    std::shared_ptr<UploadSession> session = storage.openSession(id);
+    if (!session) {
+        sendErrorResponse(404, "Upload session not found");
+        return;
+    }
+
+    if (action.empty() && method == "GET") {
+        sendJsonResponse(getSessionJson(*session));
+    } else if (action.empty() && method == "DELETE") {
+        // Refused while chunks are being written or the session is being finalized
+        if (!session->beginRemove()) {
+            sendJsonResponse(getSessionJson(*session), 409);
+            return;
+        }
+        session->remove();
+        sendJsonResponse("{\"status\":\"success\",\"id\":\"" + id + "\"}");
+    } else if (action == "finalize" && method == "POST") {
+        // Refused while chunks are missing or still being written
+        if (!session->beginFinalize()) {
+            sendJsonResponse(getSessionJson(*session), 409);
+            return;
+        }
+        std::string filename = session->getFilename();
+        std::string fileType = getFileTypeFromName(filename);
+        auto finalized = storage.finalizeSession(*session);
+        if (!finalized.first) {
+            std::cout << COLOR_RED << "[Backend] ❌ " << filename << COLOR_RESET << std::endl;
+            if (!finalized.second.empty()) {
+                sendErrorResponse(422, "Hash mismatch: declared " + session->getOriginalHash() + ", computed " + finalized.second);
+            } else if (storage.isNameTaken(filename)) {
+                // The session stays, so the client can still cancel it
+                sendErrorResponse(409, NAME_TAKEN_MESSAGE);
+            } else {
+                sendErrorResponse(500, "Failed to save " + fileType + " to storage - atomic operation failed");
             }
-        } else {
-            return "Filename not found";
+            return;
         }
+        std::cout << COLOR_GREEN << "[Backend] ✅ " << storage.getStoredFilename() << COLOR_RESET << std::endl;
+        sendJsonResponse("{\"status\":\"success\",\"message\":\"" + getUploadMessage(fileType) + "\",\"filename\":\"" + escapeJson(storage.getStoredFilename()) + "\",\"type\":\"" + fileType + "\",\"size\":" + std::to_string(session->getSize()) + ",\"hash\":\"" + finalized.second + "\"}");
     } else {
-        filenameStart += 10; // Length of "filename=\""
-        size_t filenameEnd = body.find("\"", filenameStart);
-        if (filenameEnd == std::string::npos) {
-            return "Invalid filename format";
+        sendErrorResponse(405, "Method not allowed");
+    }
+}
+
+bool HttpHandler::handleChunkUpload(int socketFd, const std::string &request, const RequestHead &head, const std::string &target)
+{
+    std::string id = target.substr(SESSIONS_ROUTE_LENGTH + 1, target.find('?') - SESSIONS_ROUTE_LENGTH - 1);
+    size_t offset = 0;
+    size_t length = 0;
+    RequestParser::parseContentLength(head.get(HttpHeader::ContentLength), length);
+    if (!RequestParser::parseContentLength(getQueryParam(target, "offset"), offset)) {
+        return rejectStreamedUpload(400, "A chunk offset is required");
+    }
+
+    std::shared_ptr<const ConfigManager> config = ConfigManager::current();
+    StorageService storage = getStorage(config);
+    std::shared_ptr<UploadSession> session = storage.openSession(id);
+    if (!session) {
+        return rejectStreamedUpload(404, "Upload session not found");
+    }
+    size_t index = 0;
+    if (!session->locateChunk(offset, length, index)) {
+        return rejectStreamedUpload(416, "A chunk must start at a multiple of " + std::to_string(session->getChunkSize()) +
+                                         " and run to the next one or the end of the file");
+    }
+    if (!session->claimChunk(index)) {
+        return rejectStreamedUpload(409, "Chunk is already being received, or the session is being finalized");
+    }
+    if (!admitStreamedBody(socketFd, head, storage, length)) {
+        session->releaseChunk(index);
+        return false;
+    }
+
+    bool stored = storage.receiveChunk(*session, index, socketFd, head.body(request));
+    session->releaseChunk(index);
+    if (!stored) {
+        return rejectStreamedUpload(500, "Failed to store chunk");
+    }
+    sendJsonResponse("{\"status\":\"success\",\"id\":\"" + id + "\",\"offset\":" + std::to_string(offset) + ",\"length\":" + std::to_string(length) + "}");
+    return true;
+}
+
+std::string HttpHandler::getSessionJson(const UploadSession &session)
+{
+    std::string received;
+    for (const auto &range : session.getReceivedRanges()) {
+        received += (received.empty() ? "[" : ",[") + std::to_string(range.first) + "," + std::to_string(range.second) + "]";
+    }
+    return "{\"status\":\"success\",\"id\":\"" + session.getId() + "\",\"filename\":\"" + escapeJson(session.getFilename()) +
+           "\",\"size\":" + std::to_string(session.getSize()) + ",\"chunkSize\":" + std::to_string(session.getChunkSize()) +
+           ",\"received\":[" + received + "]}";
+}
+
+std::string HttpHandler::checkDeclaredSize(const std::string &originalSize, size_t receivedSize)
+{
+    size_t declaredSize = 0;
+    if (originalSize.empty() || (RequestParser::parseContentLength(originalSize, declaredSize) && declaredSize == receivedSize)) {
+        return "";
+    }
+    return "Size mismatch: declared " + originalSize + " bytes, received " + std::to_string(receivedSize);
+}
+
+std::string HttpHandler::checkDeclaredIntegrity(IntegrityHasher &hasher, const std::string &originalHash, const std::string &originalSize, size_t receivedSize)
+{
+    std::string error = checkDeclaredSize(originalSize, receivedSize);
+    if (error.empty()) {
+        error = IntegrityHasher::checkDeclared(originalHash);
+    }
+    if (!error.empty()) {
+        return error;
+    }
+    hasher.expect(originalHash);
+    if (hasher.verify() == IntegrityHasher::Verdict::Mismatch) {
+        return "Hash mismatch: declared " + originalHash + ", computed " + hasher.finish();
+    }
+    return "";
+}
+
+std::string HttpHandler::getFileTypeFromName(const std::string &filename)
+{
+    std::string fileExtension = "";
+    size_t dotPos = filename.find_last_of('.');
+    if (dotPos != std::string::npos) {
+        fileExtension = filename.substr(dotPos + 1);
+        std::transform(fileExtension.begin(), fileExtension.end(), fileExtension.begin(), ::tolower);
+    }
+    return determineFileType(fileExtension);
+}
+
+std::string HttpHandler::getUploadMessage(const std::string &fileType)
+{
+    return (fileType == "video") ? "Video uploaded successfully" : 
+           (fileType == "audio") ? "Audio uploaded successfully" :
+           (fileType == "image") ? "Image uploaded successfully" :
+           (fileType == "document") ? "Document uploaded successfully" :
+           (fileType == "code") ? "Code file uploaded successfully" :
+           (fileType == "binary") ? "Binary file uploaded successfully" :
+           "File uploaded successfully";
+}
+
+std::string HttpHandler::getQueryParam(const std::string &target, const std::string &name)
+{
+    size_t query = target.find('?');
+    while (query != std::string::npos) {
+        size_t start = query + 1;
+        size_t end = target.find('&', start);
+        std::string pair = target.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        if (pair.compare(0, name.size() + 1, name + "=") == 0) {
+            return pair.substr(name.size() + 1);
         }
-        filename = body.substr(filenameStart, filenameEnd - filenameStart);
+        query = end;
     }
-    
-    // Find file content start (after headers)
-    size_t dataStart = body.find("\r\n\r\n", fileStart);
-    if (dataStart == std::string::npos) {
-        // Try alternative line endings
-        dataStart = body.find("\n\n", fileStart);
-        if (dataStart != std::string::npos) {
-            dataStart += 2;
+    return "";
+}
+
+std::string HttpHandler::decodePathSegment(const std::string &segment)
+{
+    std::string decoded;
+    for (size_t i = 0; i < segment.size(); i++) {
+        if (segment[i] == '%' && i + 2 < segment.size() &&
+            isxdigit(static_cast<unsigned char>(segment[i + 1])) && isxdigit(static_cast<unsigned char>(segment[i + 2]))) {
+            decoded += static_cast<char>(std::stoi(segment.substr(i + 1, 2), nullptr, 16));
+            i += 2;
         } else {
-            return "File data not found";
+            decoded += segment[i];
         }
-    } else {
-        dataStart += 4; // Skip \r\n\r\n
     }
-    
-    // Find file content end (next boundary) - try multiple patterns
-    size_t dataEnd = std::string::npos;
-    std::vector<std::string> endPatterns = {
-        "\r\n--" + boundary,
-        "\n--" + boundary,
-        "--" + boundary
-    };
-    
-    for (const auto& pattern : endPatterns) {
-        dataEnd = body.find(pattern, dataStart);
-        if (dataEnd != std::string::npos) {
-            break;
+    // Only a bare file name is accepted
+    if (decoded.find('/') != std::string::npos || decoded.find('\\') != std::string::npos ||
+        decoded == "." || decoded == "..") {
+        return "";
+    }
+    return decoded;
+}
+
+std::string HttpHandler::escapeJson(const std::string &text)
+{
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else if (c == '\r') {
+            escaped += "\\r";
+        } else if (c == '\t') {
+            escaped += "\\t";
+        } else if (byte < 0x20) {
+            escaped += "\\u00";
+            escaped += HEX_DIGITS[byte >> 4];
+            escaped += HEX_DIGITS[byte & 0x0f];
+        } else {
+            escaped += c;
         }
     }
+    return escaped;
+}
+
+std::string HttpHandler::parseMultipartData(const std::string &request, const RequestHead &head, std::string &filename, std::string_view &fileData, 
+                                           std::string &originalHash, std::string &originalSize, std::string &timestamp)
+{
+    if (!head.has(HttpHeader::ContentType)) {
+        return "Missing Content-Type header";
+    }
     
-    if (dataEnd == std::string::npos) {
-        return "File data end not found";
+    std::string boundary = getBoundary(head.get(HttpHeader::ContentType));
+    if (boundary.empty()) {
+        return "Invalid multipart boundary";
     }
     
-    // Extract file data
-    size_t fileSize = dataEnd - dataStart;
+    std::string_view body = head.body(request);
     
-    if (fileSize > 0) {
-        fileData.assign(body.begin() + dataStart, body.begin() + dataEnd);
-    } else {
+    // One pass over the body: every part and field is picked up as the parser reaches it
+    std::string fieldName;
+    std::string fieldValue;
+    bool sawFile = false;
+    bool inFilePart = false;
+    
+    MultipartParser parser(boundary);
+    parser.onPartBegin([&](const std::string &partHeaders) {
+        fieldName = MultipartParser::getDispositionParam(partHeaders, "name");
+        fieldValue.clear();
+        inFilePart = fieldName == "file" && !sawFile;
+        if (inFilePart) {
+            sawFile = true;
+            filename = MultipartParser::getDispositionParam(partHeaders, "filename");
+            return !filename.empty();
+        }
+        return true;
+    });
+    parser.onPartData([&](const char *data, size_t length) {
+        if (inFilePart) {
+            // The whole body is fed at once, so the part arrives as one contiguous slice
+            if (!fileData.empty() && fileData.data() + fileData.size() != data) {
+                return false;
+            }
+            fileData = std::string_view(fileData.empty() ? data : fileData.data(), fileData.size() + length);
+        } else {
+            fieldValue.append(data, length);
+        }
+        return true;
+    });
+    parser.onPartEnd([&]() {
+        if (fieldName == "originalHash") originalHash = fieldValue;
+        else if (fieldName == "originalSize") originalSize = fieldValue;
+        else if (fieldName == "timestamp") timestamp = fieldValue;
+        return true;
+    });
+    
+    bool parsed = parser.feed(body.data(), body.size());
+    
+    if (!sawFile) {
+        return "File field not found";
+    }
+    if (filename.empty()) {
+        return "Filename not found";
+    }
+    if (!parsed || !parser.isComplete()) {
+        return "File data end not found";
+    }
+    if (fileData.empty()) {
         return "Invalid file size";
     }
     
-    // Parse additional integrity fields
-    parseIntegrityFields(body, originalHash, originalSize, timestamp);
-    
     return "success";
 }
 
-std::string HttpHandler::getBoundary(const std::string &contentType)
+std::string HttpHandler::getBoundary(std::string_view contentType)
 {
     size_t boundaryPos = contentType.find("boundary=");
-    if (boundaryPos == std::string::npos) {
+    if (boundaryPos == std::string_view::npos) {
         return "";
     }
     
-    return contentType.substr(boundaryPos + 9);
+    return std::string(contentType.substr(boundaryPos + 9));
 }
 
 // ---------------------------- Helper Functions ------------------------------>
 
+void HttpHandler::sendResponse(const std::string &response)
+{
+    if (responseBuffer) {
+        responseBuffer->append(response);
+        return;
+    }
+    send(clientSocket, response.c_str(), response.length(), 0);
+}
+
+std::string &HttpHandler::responseTarget(std::string &scratch)
+{
+    // Built in place, the connection's buffer keeps its capacity for the next request
+    return responseBuffer ? *responseBuffer : scratch;
+}
+
+void HttpHandler::sendBuilt(const std::string &response)
+{
+    if (!responseBuffer) {
+        sendResponse(response);
+    }
+}
+
+const char *HttpHandler::connectionHeader() const
+{
+    // Ends the header block; the event loop decides whether the socket stays open
+    return keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+}
+
 void HttpHandler::sendCorsResponse()
 {
-    std::string response = "HTTP/1.1 200 OK\r\n";
+    std::string scratch;
+    std::string &response = responseTarget(scratch);
+    response += "HTTP/1.1 200 OK\r\n";
     response += "Access-Control-Allow-Origin: *\r\n";
-    response += "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n";
-    response += "Access-Control-Allow-Headers: Content-Type\r\n";
-    response += "Connection: close\r\n\r\n";
+    response += "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n";
+    response += "Access-Control-Allow-Headers: Content-Type, X-Original-Hash\r\n";
+    response += "Content-Length: 0\r\n";
+    response += connectionHeader();
     
-    send(clientSocket, response.c_str(), response.length(), 0);
+    sendBuilt(response);
 }
 
 void HttpHandler::sendJsonResponse(const std::string &json, int statusCode)
 {
-    std::string statusText = (statusCode == 200) ? "OK" : "Error";
-    
-    std::string response = "HTTP/1.1 " + std::to_string(statusCode) + " " + statusText + "\r\n";
+    std::string scratch;
+    std::string &response = responseTarget(scratch);
+    response += "HTTP/1.1 ";
+    response += std::to_string(statusCode);
+    response += statusCode == 200 ? " OK\r\n" : " Error\r\n";
     response += "Content-Type: application/json\r\n";
     response += "Access-Control-Allow-Origin: *\r\n";
-    response += "Connection: close\r\n\r\n";
+    response += "Content-Length: ";
+    response += std::to_string(json.length());
+    response += "\r\n";
+    response += connectionHeader();
     response += json;
     
-    send(clientSocket, response.c_str(), response.length(), 0);
+    sendBuilt(response);
 }
 
 void HttpHandler::sendErrorResponse(int statusCode, const std::string &message)
 {
-    std::string json = "{\"status\":\"error\",\"message\":\"" + message + "\"}";
+    std::string json = "{\"status\":\"error\",\"message\":\"" + escapeJson(message) + "\"}";
     sendJsonResponse(json, statusCode);
 }
 
+void HttpHandler::sendBusyResponse(int retryAfter)
+{
+    static const char json[] = "{\"status\":\"error\",\"message\":\"Server busy, please retry later\"}";
+    
+    std::string scratch;
+    std::string &response = responseTarget(scratch);
+    response += "HTTP/1.1 503 Service Unavailable\r\n";
+    response += "Content-Type: application/json\r\n";
+    response += "Access-Control-Allow-Origin: *\r\n";
+    response += "Retry-After: ";
+    response += std::to_string(retryAfter);
+    response += "\r\n";
+    response += "Content-Length: ";
+    response += std::to_string(sizeof(json) - 1);
+    response += "\r\n";
+    response += connectionHeader();
+    response += json;
+    
+    sendBuilt(response);
+}
+
 void HttpHandler::serveFile(const std::string& path, const std::string& contentType) {
     std::ifstream file(path, std::ios::in | std::ios::binary);
     if (!file) {
@@ -504,100 +1134,18 @@ void HttpHandler::serveFile(const std::string& path, const std::string& contentT
     std::string response = "HTTP/1.1 200 OK\r\n";
     response += "Content-Type: " + contentType + "\r\n";
     response += "Content-Length: " + std::to_string(contentStr.length()) + "\r\n";
-    response += "Connection: close\r\n\r\n";
+    response += connectionHeader();
     response += contentStr;
 
-    send(clientSocket, response.c_str(), response.length(), 0);
-}
-
-std::map<std::string, std::string> HttpHandler::parseHeaders(const std::string &request)
-{
-    std::map<std::string, std::string> headers;
-    std::stringstream ss(request);
-    std::string line;
-    
-    // Skip request line
-    std::getline(ss, line);
-    
-    // Parse headers
-    while (std::getline(ss, line) && line != "\r") {
-        size_t colonPos = line.find(':');
-        if (colonPos != std::string::npos) {
-            std::string key = line.substr(0, colonPos);
-            std::string value = line.substr(colonPos + 1);
-            
-            // Convert key to lowercase and trim whitespace
-            std::transform(key.begin(), key.end(), key.begin(), ::tolower);
-            
-            // Trim leading/trailing whitespace from value
-            value.erase(0, value.find_first_not_of(" \t"));
-            value.erase(value.find_last_not_of(" \t\r") + 1);
-            
-            headers[key] = value;
-        }
-    }
-    
-    return headers;
-}
-
-std::string HttpHandler::getRequestBody(const std::string &request)
-{
-    size_t bodyStart = request.find("\r\n\r\n");
-    if (bodyStart == std::string::npos) {
-        return "";
-    }
-    
-    return request.substr(bodyStart + 4);
-}
-
-void HttpHandler::parseIntegrityFields(const std::string &body, std::string &originalHash, std::string &originalSize, std::string &timestamp)
-{
-    // Parse originalHash field
-    size_t hashPos = body.find("name=\"originalHash\"");
-    if (hashPos != std::string::npos) {
-        size_t valueStart = body.find("\r\n\r\n", hashPos);
-        if (valueStart != std::string::npos) {
-            valueStart += 4;
-            size_t valueEnd = body.find("\r\n--", valueStart);
-            if (valueEnd != std::string::npos) {
-                originalHash = body.substr(valueStart, valueEnd - valueStart);
-            }
-        }
-    }
-    
-    // Parse originalSize field
-    size_t sizePos = body.find("name=\"originalSize\"");
-    if (sizePos != std::string::npos) {
-        size_t valueStart = body.find("\r\n\r\n", sizePos);
-        if (valueStart != std::string::npos) {
-            valueStart += 4;
-            size_t valueEnd = body.find("\r\n--", valueStart);
-            if (valueEnd != std::string::npos) {
-                originalSize = body.substr(valueStart, valueEnd - valueStart);
-            }
-        }
-    }
-    
-    // Parse timestamp field
-    size_t timestampPos = body.find("name=\"timestamp\"");
-    if (timestampPos != std::string::npos) {
-        size_t valueStart = body.find("\r\n\r\n", timestampPos);
-        if (valueStart != std::string::npos) {
-            valueStart += 4;
-            size_t valueEnd = body.find("\r\n--", valueStart);
-            if (valueEnd != std::string::npos) {
-                timestamp = body.substr(valueStart, valueEnd - valueStart);
-            }
-        }
-    }
-    
-    // Skip integrity logging for cleaner output
+    sendResponse(response);
 }
 
 // ---------------------------- Stop listening ------------------------------>
 
 HttpHandler::~HttpHandler()
 {
-    close(clientSocket);
+    if (clientSocket >= 0) {
+        close(clientSocket);
+    }
 }
 
@@ -2,47 +2,79 @@
 #define CLIENT_HANDLER_HPP
 
 #include <iostream>
-#include <vector>
-#include <map>
 #include <fstream>
 #include <sstream>
+#include <string_view>
+#include "RequestParser.hpp"
+
+class StorageService;
+class IntegrityHasher;
+class UploadSession;
 
 class HttpHandler
 {
 public:
     HttpHandler(int clientSocket, bool isFrontend = true);
+    // Buffered mode: responses are appended to responseBuffer instead of sent
+    HttpHandler(std::string &responseBuffer, bool isFrontend, bool keepAlive = false);
     ~HttpHandler();
 
     void handleRequest();
+    void handleRequest(const std::string &request);
+    // PUT /upload/<name>: head holds the headers and any body read so far.
+    // Returns false when the body was not fully consumed from the socket.
+    bool handleStreamedUpload(int socketFd, const std::string &head);
 
     std::string parseRequest();
-    std::string extractRoute(const std::string &input);
-    std::string extractMethod(const std::string &request);
     void serveFile(const std::string& path, const std::string& contentType);
     void sendJsonResponse(const std::string &json, int statusCode = 200);
     void sendErrorResponse(int statusCode, const std::string &message);
+    // 503 with Retry-After, for uploads turned away by the UploadGovernor
+    void sendBusyResponse(int retryAfter);
     void sendCorsResponse();
 
 private:
     int clientSocket;
     bool isFrontend;
+    std::string *responseBuffer;
+    bool keepAlive;
     
     // Basic HTTP handling
     void sendResponse(const std::string &response);
+    // Where a response is built: the connection's buffer if there is one, else scratch
+    std::string &responseTarget(std::string &scratch);
+    void sendBuilt(const std::string &response);
+    const char *connectionHeader() const;
     std::string handleRoute(std::string input);
     std::string getHtmlContent(const std::string &route = "/");
     
     // File upload handling
-    void handleFileUpload(const std::string &request);
-    std::string parseMultipartData(const std::string &request, std::string &filename, std::vector<char> &fileData, 
+    void handleFileUpload(const std::string &request, const RequestHead &head);
+    bool handleMultipartUpload(int socketFd, const std::string &request, const RequestHead &head);
+    bool handleRawUpload(int socketFd, const std::string &request, const RequestHead &head, const std::string &filename);
+    // Resumable uploads: POST /upload/sessions, GET|DELETE /upload/sessions/<id>,
+    // PUT /upload/sessions/<id>?offset=N and POST /upload/sessions/<id>/finalize
+    // POST /upload/existing?filename=..&size=.. with X-Original-Hash: links
+    // content the server already stores, 404 when the file has to be sent
+    void handleExistingUpload(const std::string &target, const RequestHead &head);
+    void handleSessionRequest(const std::string &method, const std::string &target, const RequestHead &head);
+    bool handleChunkUpload(int socketFd, const std::string &request, const RequestHead &head, const std::string &target);
+    std::string getSessionJson(const UploadSession &session);
+    bool rejectStreamedUpload(int statusCode, const std::string &message);
+    bool admitStreamedBody(int socketFd, const RequestHead &head, const StorageService &storage, size_t incomingSize);
+    std::string parseMultipartData(const std::string &request, const RequestHead &head, std::string &filename, std::string_view &fileData, 
                                    std::string &originalHash, std::string &originalSize, std::string &timestamp);
-    std::string getBoundary(const std::string &contentType);
+    // Both return an empty string when the upload matches what the client declared
+    std::string checkDeclaredSize(const std::string &originalSize, size_t receivedSize);
+    std::string checkDeclaredIntegrity(IntegrityHasher &hasher, const std::string &originalHash, const std::string &originalSize, size_t receivedSize);
+    std::string getBoundary(std::string_view contentType);
     std::string determineFileType(const std::string &extension);
-    
-    // Request parsing helpers
-    std::map<std::string, std::string> parseHeaders(const std::string &request);
-    std::string getRequestBody(const std::string &request);
-    void parseIntegrityFields(const std::string &body, std::string &originalHash, std::string &originalSize, std::string &timestamp);
+    std::string getFileTypeFromName(const std::string &filename);
+    std::string getUploadMessage(const std::string &fileType);
+    std::string decodePathSegment(const std::string &segment);
+    // For client-supplied text (file names, hashes) placed inside a JSON string
+    std::string escapeJson(const std::string &text);
+    std::string getQueryParam(const std::string &target, const std::string &name);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,248 @@
+#include "MultipartParser.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+static const size_t MAX_PART_HEADER_SIZE = 16 * 1024;
+
+// ----------------------------- Constructor --------------------------------->
+
+MultipartParser::MultipartParser(const std::string &boundary)
+    : state(State::Preamble),
+      dashBoundary("--" + boundary),
+      delimiter("\r\n--" + boundary),
+      scanner(delimiter)
+{
+    if (boundary.empty()) {
+        fail("Invalid multipart boundary");
+    }
+}
+
+void MultipartParser::onPartBegin(PartBeginHandler handler)
+{
+    partBegin = std::move(handler);
+}
+
+void MultipartParser::onPartData(PartDataHandler handler)
+{
+    partData = std::move(handler);
+}
+
+void MultipartParser::onPartEnd(PartEndHandler handler)
+{
+    partEnd = std::move(handler);
+}
+
+bool MultipartParser::isComplete() const
+{
+    return state == State::Done;
+}
+
+std::string MultipartParser::getError() const
+{
+    return error;
+}
+
+// ----------------------------- Feeding --------------------------------->
+
+bool MultipartParser::feed(const char *data, size_t length)
+{
+    while (length > 0) {
+        size_t used = 0;
+        switch (state) {
+            case State::Preamble:       used = consumePreamble(data, length); break;
+            case State::Headers:        used = consumeHeaders(data, length); break;
+            case State::Body:           used = consumeBody(data, length); break;
+            case State::AfterDelimiter: used = consumeAfterDelimiter(data, length); break;
+            case State::Done:           return true; // Epilogue is ignored
+            case State::Failed:         return false;
+        }
+        data += used;
+        length -= used;
+    }
+    return state != State::Failed;
+}
+
+size_t MultipartParser::consumePreamble(const char *data, size_t length)
+{
+    size_t before = pending.size();
+    pending.append(data, length);
+
+    std::string opener = dashBoundary + "\r\n";
+    size_t pos = pending.find(opener);
+    if (pos == std::string::npos) {
+        // Only a tail that could still grow into the opener is worth keeping
+        if (pending.size() > opener.size()) {
+            pending.erase(0, pending.size() - opener.size());
+        }
+        return length;
+    }
+
+    size_t used = pos + opener.size() - before;
+    pending.clear();
+    state = State::Headers;
+    return used;
+}
+
+size_t MultipartParser::consumeHeaders(const char *data, size_t length)
+{
+    size_t before = pending.size();
+    pending.append(data, std::min(length, MAX_PART_HEADER_SIZE + 4 - before));
+
+    // A part without headers starts straight with the blank line
+    size_t end = std::string::npos;
+    if (pending.compare(0, 2, "\r\n") == 0) {
+        end = 2;
+    } else {
+        size_t pos = pending.find("\r\n\r\n");
+        if (pos != std::string::npos) end = pos + 4;
+    }
+
+    if (end == std::string::npos) {
+        if (pending.size() > MAX_PART_HEADER_SIZE) {
+            fail("Multipart headers too large");
+        }
+        return pending.size() - before;
+    }
+
+    std::string headers = pending.substr(0, end);
+    pending.clear();
+    state = State::Body;
+    if (partBegin && !partBegin(headers)) {
+        fail("Upload rejected");
+    }
+    return end - before;
+}
+
+size_t MultipartParser::consumeBody(const char *data, size_t length)
+{
+    if (!pending.empty()) {
+        // A delimiter may straddle the previous feed and this one
+        size_t take = std::min(length, delimiter.size());
+        std::string window = pending + std::string(data, take);
+
+        size_t pos = scanner.find(window.data(), window.size());
+        if (pos != BoundaryScanner::npos && pos < pending.size()) {
+            size_t used = pos + delimiter.size() - pending.size();
+            if (!emitData(window.data(), pos)) return length;
+            pending.clear();
+            state = State::AfterDelimiter;
+            if (partEnd && !partEnd()) fail("Upload rejected");
+            return used;
+        }
+
+        // Keep the earliest carried byte that could still begin a delimiter
+        size_t keepFrom = pending.size();
+        for (size_t start = 0; start < pending.size(); start++) {
+            size_t available = window.size() - start;
+            if (available < delimiter.size() && delimiter.compare(0, available, window, start, available) == 0) {
+                keepFrom = start;
+                break;
+            }
+        }
+        if (!emitData(window.data(), keepFrom)) return length;
+        if (keepFrom < pending.size()) {
+            pending = window.substr(keepFrom);
+            return take;
+        }
+        pending.clear();
+        return 0;
+    }
+
+    size_t pos = scanner.find(data, length);
+    if (pos != BoundaryScanner::npos) {
+        if (!emitData(data, pos)) return length;
+        state = State::AfterDelimiter;
+        if (partEnd && !partEnd()) fail("Upload rejected");
+        return pos + delimiter.size();
+    }
+
+    // Hold back the longest tail that is a prefix of the delimiter
+    size_t held = scanner.partialMatchAtEnd(data, length);
+    if (!emitData(data, length - held)) return length;
+    pending.assign(data + length - held, held);
+    return length;
+}
+
+size_t MultipartParser::consumeAfterDelimiter(const char *data, size_t length)
+{
+    size_t before = pending.size();
+    pending.append(data, std::min<size_t>(length, 256));
+
+    if (pending.size() >= 2 && pending.compare(0, 2, "--") == 0) {
+        pending.clear();
+        state = State::Done;
+        return length;
+    }
+
+    // Transport padding may sit between the delimiter and its line break
+    size_t pos = pending.find("\r\n");
+    if (pos == std::string::npos) {
+        if (pending.size() >= 256) fail("Malformed multipart delimiter");
+        return pending.size() - before;
+    }
+
+    size_t used = pos + 2 - before;
+    pending.clear();
+    state = State::Headers;
+    return used;
+}
+
+// ----------------------------- Helpers --------------------------------->
+
+bool MultipartParser::emitData(const char *data, size_t length)
+{
+    if (length == 0 || !partData) {
+        return true;
+    }
+    if (!partData(data, length)) {
+        return fail("Upload rejected");
+    }
+    return true;
+}
+
+bool MultipartParser::fail(const std::string &message)
+{
+    if (state != State::Failed) {
+        error = message;
+        state = State::Failed;
+    }
+    return false;
+}
+
+std::string MultipartParser::getDispositionParam(const std::string &headers, const std::string &param)
+{
+    std::string lower = headers;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+    size_t lineStart = lower.find("content-disposition:");
+    if (lineStart == std::string::npos) {
+        return "";
+    }
+    size_t lineEnd = lower.find("\r\n", lineStart);
+
+    // Match "; name=" but not the tail of "; filename="
+    size_t pos = lineStart;
+    while (true) {
+        pos = lower.find(param + "=", pos);
+        if (pos == std::string::npos || pos > lineEnd) {
+            return "";
+        }
+        char previous = lower[pos - 1];
+        if (previous == ';' || previous == ' ' || previous == '\t') {
+            break;
+        }
+        pos += param.size();
+    }
+
+    size_t valueStart = pos + param.size() + 1;
+    if (valueStart < headers.size() && headers[valueStart] == '"') {
+        size_t valueEnd = headers.find('"', valueStart + 1);
+        if (valueEnd == std::string::npos || valueEnd > lineEnd) {
+            return "";
+        }
+        return headers.substr(valueStart + 1, valueEnd - valueStart - 1);
+    }
+    size_t valueEnd = headers.find_first_of("; \t\r", valueStart);
+    return headers.substr(valueStart, valueEnd - valueStart);
+}
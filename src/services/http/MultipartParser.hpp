@@ -0,0 +1,61 @@
+#ifndef MULTIPART_PARSER_HPP
+#define MULTIPART_PARSER_HPP
+
+#include "BoundaryScanner.hpp"
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// Push-style multipart/form-data parser. Bytes are fed in whatever pieces
+// the socket delivers them and part bodies are handed on as they are found,
+// so memory use is bounded by the part headers, not by the body size. Part
+// bodies are searched with BoundaryScanner in a single pass; a delimiter split
+// across two feeds is carried over in at most delimiter-length bytes.
+class MultipartParser
+{
+public:
+    // Handlers return false to abort parsing
+    using PartBeginHandler = std::function<bool(const std::string &headers)>;
+    using PartDataHandler = std::function<bool(const char *data, size_t length)>;
+    using PartEndHandler = std::function<bool()>;
+
+    explicit MultipartParser(const std::string &boundary);
+
+    void onPartBegin(PartBeginHandler handler);
+    void onPartData(PartDataHandler handler);
+    void onPartEnd(PartEndHandler handler);
+
+    // Returns false once the input is malformed or a handler refused it
+    bool feed(const char *data, size_t length);
+
+    // The closing delimiter has been seen
+    bool isComplete() const;
+    std::string getError() const;
+
+    // Value of a Content-Disposition parameter such as name or filename
+    static std::string getDispositionParam(const std::string &headers, const std::string &param);
+
+private:
+    enum class State { Preamble, Headers, Body, AfterDelimiter, Done, Failed };
+
+    State state;
+    std::string dashBoundary;   // "--" + boundary, opens the first part
+    std::string delimiter;      // "\r\n--" + boundary, ends every part
+    BoundaryScanner scanner;
+    std::string pending;        // Partial line, headers, or delimiter prefix
+    std::string error;
+
+    PartBeginHandler partBegin;
+    PartDataHandler partData;
+    PartEndHandler partEnd;
+
+    size_t consumePreamble(const char *data, size_t length);
+    size_t consumeHeaders(const char *data, size_t length);
+    size_t consumeBody(const char *data, size_t length);
+    size_t consumeAfterDelimiter(const char *data, size_t length);
+
+    bool emitData(const char *data, size_t length);
+    bool fail(const std::string &message);
+};
+
+#endif // MULTIPART_PARSER_HPP
@@ -0,0 +1,235 @@
+#include "RequestParser.hpp"
+#include <array>
+#include <limits>
+
+// ----------------------------- Lookup Tables --------------------------------->
+
+static constexpr std::array<unsigned char, 256> LOWER_CASE = []() {
+    std::array<unsigned char, 256> table {};
+    for (size_t c = 0; c < table.size(); c++) {
+        table[c] = static_cast<unsigned char>(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+    }
+    return table;
+}();
+
+struct KnownHeader
+{
+    std::string_view name;
+    HttpHeader header;
+};
+
+static constexpr KnownHeader KNOWN_HEADERS[] = {
+    {"content-length", HttpHeader::ContentLength},
+    {"content-type", HttpHeader::ContentType},
+    {"connection", HttpHeader::Connection},
+    {"expect", HttpHeader::Expect},
+    {"transfer-encoding", HttpHeader::TransferEncoding},
+    {"x-original-hash", HttpHeader::OriginalHash},
+};
+
+// Known header names all differ in length, so the length alone picks the one
+// candidate worth comparing
+static constexpr size_t MAX_KNOWN_NAME = 32;
+static constexpr std::array<int, MAX_KNOWN_NAME> KNOWN_BY_LENGTH = []() {
+    std::array<int, MAX_KNOWN_NAME> table {};
+    for (int &slot : table) slot = -1;
+    for (size_t i = 0; i < sizeof(KNOWN_HEADERS) / sizeof(KNOWN_HEADERS[0]); i++) {
+        table[KNOWN_HEADERS[i].name.size()] = static_cast<int>(i);
+    }
+    return table;
+}();
+
+static int identifyHeader(std::string_view name)
+{
+    if (name.size() >= MAX_KNOWN_NAME) {
+        return -1;
+    }
+    int index = KNOWN_BY_LENGTH[name.size()];
+    if (index < 0 || !RequestParser::equalsIgnoreCase(name, KNOWN_HEADERS[index].name)) {
+        return -1;
+    }
+    return static_cast<int>(KNOWN_HEADERS[index].header);
+}
+
+// ----------------------------- Helpers --------------------------------->
+
+static std::string_view trim(std::string_view value)
+{
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+    return value;
+}
+
+// Splits the next "Name: value\r\n" line off headerLines. Returns false at the
+// end or on a line that is not a valid header field.
+static bool nextHeader(std::string_view lines, size_t &cursor, std::string_view &name, std::string_view &value, bool &valid)
+{
+    valid = true;
+    if (cursor >= lines.size()) {
+        return false;
+    }
+    size_t lineEnd = lines.find("\r\n", cursor);
+    if (lineEnd == std::string_view::npos) {
+        lineEnd = lines.size();
+    }
+    std::string_view line = lines.substr(cursor, lineEnd - cursor);
+    cursor = lineEnd + 2;
+
+    // No folded continuation lines and no whitespace before the colon (RFC 7230 3.2.4)
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos || colon == 0 ||
+        line[0] == ' ' || line[0] == '\t' || line[colon - 1] == ' ' || line[colon - 1] == '\t') {
+        valid = false;
+        return false;
+    }
+    name = line.substr(0, colon);
+    value = trim(line.substr(colon + 1));
+    return true;
+}
+
+// ----------------------------- RequestHead --------------------------------->
+
+std::string_view RequestHead::get(HttpHeader header) const
+{
+    return known[static_cast<size_t>(header)];
+}
+
+bool RequestHead::has(HttpHeader header) const
+{
+    return present[static_cast<size_t>(header)];
+}
+
+std::string_view RequestHead::find(std::string_view name) const
+{
+    size_t cursor = 0;
+    std::string_view headerName;
+    std::string_view value;
+    bool valid;
+    while (nextHeader(headerLines, cursor, headerName, value, valid)) {
+        if (RequestParser::equalsIgnoreCase(headerName, name)) {
+            return value;
+        }
+    }
+    return std::string_view();
+}
+
+bool RequestHead::isHttp11() const
+{
+    return version == "HTTP/1.1";
+}
+
+std::string_view RequestHead::body(std::string_view request) const
+{
+    return size <= request.size() ? request.substr(size) : std::string_view();
+}
+
+// ----------------------------- RequestParser --------------------------------->
+
+size_t RequestParser::findHeaderEnd(std::string_view input, size_t from)
+{
+    // Back up in case the terminator straddles the previous scan's end
+    from = from > 3 ? from - 3 : 0;
+    size_t pos = input.find("\r\n\r\n", from);
+    return pos == std::string_view::npos ? pos : pos + 4;
+}
+
+RequestParser::Result RequestParser::parse(std::string_view input, RequestHead &head)
+{
+    head = RequestHead();
+
+    size_t end = findHeaderEnd(input);
+    if (end == std::string_view::npos) {
+        return Result::Incomplete;
+    }
+
+    // Request line: METHOD SP target SP HTTP/x.y
+    size_t lineEnd = input.find("\r\n");
+    std::string_view line = input.substr(0, lineEnd);
+    size_t methodEnd = line.find(' ');
+    if (methodEnd == std::string_view::npos || methodEnd == 0) {
+        return Result::Invalid;
+    }
+    size_t targetEnd = line.find(' ', methodEnd + 1);
+    if (targetEnd == std::string_view::npos || targetEnd == methodEnd + 1) {
+        return Result::Invalid;
+    }
+    head.method = line.substr(0, methodEnd);
+    head.target = line.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    head.version = line.substr(targetEnd + 1);
+    if (head.version.size() != 8 || head.version.compare(0, 5, "HTTP/") != 0) {
+        return Result::Invalid;
+    }
+
+    head.size = end;
+    size_t linesStart = lineEnd + 2;
+    head.headerLines = linesStart < end - 2 ? input.substr(linesStart, end - 2 - linesStart) : std::string_view();
+
+    size_t cursor = 0;
+    std::string_view name;
+    std::string_view value;
+    bool valid;
+    while (nextHeader(head.headerLines, cursor, name, value, valid)) {
+        int id = identifyHeader(name);
+        if (id < 0) {
+            continue;
+        }
+        if (head.present[id]) {
+            // Conflicting lengths are how request smuggling starts
+            if (id == static_cast<int>(HttpHeader::ContentLength) && value != head.known[id]) {
+                return Result::Invalid;
+            }
+            continue;
+        }
+        head.known[id] = value;
+        head.present[id] = true;
+    }
+    return valid ? Result::Complete : Result::Invalid;
+}
+
+bool RequestParser::parseContentLength(std::string_view value, size_t &length)
+{
+    if (value.empty()) {
+        return false;
+    }
+    size_t result = 0;
+    for (char c : value) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        size_t digit = static_cast<size_t>(c - '0');
+        if (result > (std::numeric_limits<size_t>::max() - digit) / 10) {
+            return false;
+        }
+        result = result * 10 + digit;
+    }
+    length = result;
+    return true;
+}
+
+bool RequestParser::equalsIgnoreCase(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (LOWER_CASE[static_cast<unsigned char>(a[i])] != LOWER_CASE[static_cast<unsigned char>(b[i])]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RequestParser::hasToken(std::string_view value, std::string_view token)
+{
+    while (!value.empty()) {
+        size_t comma = value.find(',');
+        if (equalsIgnoreCase(trim(value.substr(0, comma)), token)) {
+            return true;
+        }
+        if (comma == std::string_view::npos) {
+            break;
+        }
+        value.remove_prefix(comma + 1);
+    }
+    return false;
+}
@@ -0,0 +1,61 @@
+#ifndef REQUEST_PARSER_HPP
+#define REQUEST_PARSER_HPP
+
+#include <cstddef>
+#include <string_view>
+
+// Headers the server acts on. Their values are picked out while parsing so
+// lookups are an array index instead of a search.
+enum class HttpHeader
+{
+    ContentLength,
+    ContentType,
+    Connection,
+    Expect,
+    TransferEncoding,
+    OriginalHash,       // X-Original-Hash, the client's hash of an upload
+    Count
+};
+
+// Request line and headers of one HTTP/1.x request. Every field is a view
+// into the buffer that was parsed, which has to outlive the RequestHead.
+struct RequestHead
+{
+    std::string_view method;
+    std::string_view target;
+    std::string_view version;
+    std::string_view headerLines;   // Everything between the request line and the blank line
+    size_t size = 0;                // Bytes up to and including the blank line
+
+    std::string_view get(HttpHeader header) const;
+    bool has(HttpHeader header) const;
+    // Any header by name, case-insensitive (a linear scan; prefer get())
+    std::string_view find(std::string_view name) const;
+
+    bool isHttp11() const;
+    std::string_view body(std::string_view request) const;
+
+    std::string_view known[static_cast<size_t>(HttpHeader::Count)];
+    bool present[static_cast<size_t>(HttpHeader::Count)] = {};
+};
+
+// Single-pass parser for the request head. It never copies or allocates and
+// stops at the blank line, so the cost does not depend on the body size.
+class RequestParser
+{
+public:
+    enum class Result { Complete, Incomplete, Invalid };
+
+    static Result parse(std::string_view input, RequestHead &head);
+
+    // Offset just past "\r\n\r\n", or npos. from lets callers resume a scan
+    // over a buffer that has grown since the last call.
+    static size_t findHeaderEnd(std::string_view input, size_t from = 0);
+
+    static bool parseContentLength(std::string_view value, size_t &length);
+    static bool equalsIgnoreCase(std::string_view a, std::string_view b);
+    // Comma-separated header value contains token, e.g. "close" in Connection
+    static bool hasToken(std::string_view value, std::string_view token);
+};
+
+#endif // REQUEST_PARSER_HPP
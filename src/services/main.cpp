@@ -1,6 +1,7 @@
 #include <iostream>
 #include <csignal>
 #include "server/ServerManager.hpp"
+#include "config/ConfigWatcher.hpp"
 
 // Colors for terminal output
 #define COLOR_RED     "\033[0;31m"
@@ -18,9 +19,17 @@ void signalHandler(int /* signal */) {
     }
 }
 
+void reloadHandler(int /* signal */) {
+    ConfigWatcher::requestReload();
+}
+
 int main() {
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
+    // Re-read config.env without a restart
+    signal(SIGHUP, reloadHandler);
+    // Peers that disconnect mid-response must not kill the process
+    signal(SIGPIPE, SIG_IGN);
     
     try {
         ServerManager manager;
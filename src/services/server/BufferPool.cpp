@@ -0,0 +1,157 @@
+#include "BufferPool.hpp"
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+static const size_t SIZE_CLASSES[] = {BufferPool::SMALL, BufferPool::MEDIUM, BufferPool::LARGE};
+static const size_t CLASS_COUNT = sizeof(SIZE_CLASSES) / sizeof(SIZE_CLASSES[0]);
+static const size_t SLAB_LIMITS[] = {32, 16, 8}; // Idle buffers kept server-wide, per size
+static const size_t THREAD_CACHE_LIMIT = 4;      // Idle buffers a thread keeps for itself, per size
+static const size_t BUFFER_ALIGNMENT = 4096;
+
+namespace {
+
+struct Slab {
+    std::mutex mutex;
+    std::vector<char*> buffers;
+};
+
+Slab& getSlab(size_t sizeClass)
+{
+    static Slab slabs[CLASS_COUNT];
+    return slabs[sizeClass];
+}
+
+void returnToSlab(char* memory, size_t sizeClass)
+{
+    Slab& slab = getSlab(sizeClass);
+    {
+        std::lock_guard<std::mutex> lock(slab.mutex);
+        if (slab.buffers.size() < SLAB_LIMITS[sizeClass]) {
+            slab.buffers.push_back(memory);
+            return;
+        }
+    }
+    free(memory);
+}
+
+// Whatever a thread still holds goes back to the slabs when it exits
+struct ThreadCache {
+    std::vector<char*> buffers[CLASS_COUNT];
+
+    ~ThreadCache()
+    {
+        for (size_t sizeClass = 0; sizeClass < CLASS_COUNT; sizeClass++) {
+            for (char* memory : buffers[sizeClass]) {
+                returnToSlab(memory, sizeClass);
+            }
+        }
+    }
+};
+
+thread_local ThreadCache threadCache;
+
+} // namespace
+
+// ----------------------------- Buffer --------------------------------->
+
+BufferPool::Buffer::Buffer()
+    : memory(nullptr), sizeClass(0)
+{
+}
+
+BufferPool::Buffer::Buffer(char* memory, size_t sizeClass)
+    : memory(memory), sizeClass(sizeClass)
+{
+}
+
+BufferPool::Buffer::Buffer(Buffer&& other) noexcept
+    : memory(other.memory), sizeClass(other.sizeClass)
+{
+    other.memory = nullptr;
+}
+
+BufferPool::Buffer& BufferPool::Buffer::operator=(Buffer&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        memory = other.memory;
+        sizeClass = other.sizeClass;
+        other.memory = nullptr;
+    }
+    return *this;
+}
+
+BufferPool::Buffer::~Buffer()
+{
+    release();
+}
+
+char* BufferPool::Buffer::data() const
+{
+    return memory;
+}
+
+size_t BufferPool::Buffer::size() const
+{
+    return memory ? SIZE_CLASSES[sizeClass] : 0;
+}
+
+BufferPool::Buffer::operator bool() const
+{
+    return memory != nullptr;
+}
+
+void BufferPool::Buffer::release()
+{
+    if (memory) {
+        BufferPool::recycle(memory, sizeClass);
+        memory = nullptr;
+    }
+}
+
+// ----------------------------- Pool --------------------------------->
+
+BufferPool::Buffer BufferPool::acquire(size_t size)
+{
+    size_t sizeClass = 0;
+    while (sizeClass + 1 < CLASS_COUNT && SIZE_CLASSES[sizeClass] < size) {
+        sizeClass++;
+    }
+    if (SIZE_CLASSES[sizeClass] < size) {
+        return Buffer();
+    }
+
+    std::vector<char*>& cached = threadCache.buffers[sizeClass];
+    if (!cached.empty()) {
+        char* memory = cached.back();
+        cached.pop_back();
+        return Buffer(memory, sizeClass);
+    }
+
+    Slab& slab = getSlab(sizeClass);
+    {
+        std::lock_guard<std::mutex> lock(slab.mutex);
+        if (!slab.buffers.empty()) {
+            char* memory = slab.buffers.back();
+            slab.buffers.pop_back();
+            return Buffer(memory, sizeClass);
+        }
+    }
+
+    void* memory = nullptr;
+    if (posix_memalign(&memory, BUFFER_ALIGNMENT, SIZE_CLASSES[sizeClass]) != 0) {
+        return Buffer();
+    }
+    return Buffer(static_cast<char*>(memory), sizeClass);
+}
+
+void BufferPool::recycle(char* memory, size_t sizeClass)
+{
+    std::vector<char*>& cached = threadCache.buffers[sizeClass];
+    if (cached.size() < THREAD_CACHE_LIMIT) {
+        cached.push_back(memory);
+        return;
+    }
+    returnToSlab(memory, sizeClass);
+}
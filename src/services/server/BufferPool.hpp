@@ -0,0 +1,50 @@
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+
+#include <cstddef>
+
+// Page-aligned I/O buffers in a few fixed sizes, recycled across requests
+// instead of going back to the allocator (which maps and unmaps anything
+// this large on every call). Each thread keeps a few buffers of each size
+// to itself, so taking and returning one normally takes no lock; only a
+// thread's overflow and shortfall go through the shared slabs.
+class BufferPool
+{
+public:
+    static const size_t SMALL = 64 * 1024;
+    static const size_t MEDIUM = 256 * 1024;
+    static const size_t LARGE = 1024 * 1024;
+
+    // Owns one buffer and hands it back to the pool when destroyed
+    class Buffer
+    {
+    public:
+        Buffer();
+        Buffer(Buffer&& other) noexcept;
+        Buffer& operator=(Buffer&& other) noexcept;
+        ~Buffer();
+
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+
+        char* data() const;
+        size_t size() const;
+        explicit operator bool() const;
+        void release();
+
+    private:
+        friend class BufferPool;
+        Buffer(char* memory, size_t sizeClass);
+
+        char* memory;
+        size_t sizeClass;
+    };
+
+    // The smallest size that holds size bytes, at most LARGE; empty when out of memory
+    static Buffer acquire(size_t size);
+
+private:
+    static void recycle(char* memory, size_t sizeClass);
+};
+
+#endif // BUFFER_POOL_HPP
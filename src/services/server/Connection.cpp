@@ -0,0 +1,354 @@
+#include "Connection.hpp"
+#include "../http/RequestParser.hpp"
+#include "../http/HttpHandler.hpp"
+#include "../storage/MerkleHasher.hpp"
+#include "UploadGovernor.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Colors for terminal output
+#define COLOR_RED     "\033[0;31m"
+#define COLOR_YELLOW  "\033[1;33m"
+#define COLOR_RESET   "\033[0m"
+
+static const size_t READ_BUFFER_SIZE = 64 * 1024;
+static const size_t MAX_HEADER_SIZE = 1024 * 1024; // 1MB header limit
+static const size_t MAX_PIPELINED_BYTES = 1024 * 1024; // Buffered while a request is in flight
+static const size_t STREAM_BODY_THRESHOLD = 1024 * 1024; // Larger POST bodies skip the connection buffer
+// Receive buffers and parser state of one streamed upload, plus the leaves its hash tree copies out
+static const size_t STREAMED_UPLOAD_MEMORY = 1024 * 1024 + MerkleHasher::PARALLEL_MEMORY;
+static const size_t MAX_RETAINED_BUFFER = 64 * 1024; // Idle connections keep buffers up to this size for the next request
+
+// Empties a buffer for reuse; one a large body grew is given back instead
+static void recycle(std::string& buffer)
+{
+    if (buffer.capacity() > MAX_RETAINED_BUFFER) {
+        std::string().swap(buffer);
+    } else {
+        buffer.clear();
+    }
+}
+
+// ----------------------------- Constructor/Destructor --------------------------------->
+
+Connection::Connection(int clientSocket, uint64_t id, size_t maxRequests, bool isFrontend)
+    : clientSocket(clientSocket),
+      id(id),
+      state(State::ReadingHeaders),
+      requestReady(false),
+      keepAlive(false),
+      isFrontend(isFrontend),
+      streaming(false),
+      requestsServed(0),
+      maxRequests(maxRequests),
+      lastActivity(std::chrono::steady_clock::now()),
+      headerEnd(0),
+      headerScanned(0),
+      contentLength(0),
+      outOffset(0),
+      exchange(std::make_shared<RequestExchange>())
+{
+}
+
+Connection::~Connection()
+{
+    close(clientSocket);
+}
+
+int Connection::getSocket() const
+{
+    return clientSocket;
+}
+
+uint64_t Connection::getId() const
+{
+    return id;
+}
+
+bool Connection::isIdle(std::chrono::steady_clock::time_point now, std::chrono::seconds timeout) const
+{
+    // The server, not the client, is the slow side while processing
+    return state != State::Processing && now - lastActivity > timeout;
+}
+
+// ----------------------------- Event Handlers --------------------------------->
+
+bool Connection::onReadable()
+{
+    char buffer[READ_BUFFER_SIZE];
+    bool peerClosed = false;
+
+    // Edge-triggered: drain the socket until the kernel has nothing left
+    while (true) {
+        // Pipelined input beyond the limit stays in the kernel until this response is out
+        bool busy = state == State::Processing || state == State::WritingResponse;
+        if (busy && inBuffer.size() >= MAX_PIPELINED_BYTES) {
+            break;
+        }
+
+        ssize_t bytesRead;
+        size_t requestEnd = headerEnd + contentLength;
+        if (state == State::ReadingBody && inBuffer.size() < requestEnd) {
+            // A buffered body is received straight into the room reserved
+            // for it; only heads and pipelined bytes go through the stack
+            size_t used = inBuffer.size();
+            inBuffer.resize(used + std::min(requestEnd - used, READ_BUFFER_SIZE));
+            bytesRead = recv(clientSocket, &inBuffer[used], inBuffer.size() - used, 0);
+            inBuffer.resize(used + static_cast<size_t>(std::max<ssize_t>(bytesRead, 0)));
+        } else {
+            bytesRead = recv(clientSocket, buffer, sizeof(buffer), 0);
+            if (bytesRead > 0) {
+                inBuffer.append(buffer, bytesRead);
+            }
+        }
+        if (bytesRead > 0) {
+            lastActivity = std::chrono::steady_clock::now();
+            // Leave a streamed upload's body in the kernel for the worker.
+            // A body that just completed moves the connection on at once, so
+            // anything the client sends after it is held to the pipelining cap
+            bool bodyComplete = state == State::ReadingBody && inBuffer.size() >= headerEnd + contentLength;
+            if (state == State::ReadingHeaders || bodyComplete) {
+                if (!advance()) return false;
+                if (streaming) break;
+            }
+            continue;
+        }
+        if (bytesRead == 0) {
+            peerClosed = true;
+            break;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        return false;
+    }
+
+    if (!advance()) {
+        return false;
+    }
+
+    // A half-closed peer can still receive the response it is waiting for
+    return !peerClosed || state == State::Processing || state == State::WritingResponse;
+}
+
+bool Connection::onWritable()
+{
+    if (state != State::WritingResponse) {
+        return true;
+    }
+    return flushOutput();
+}
+
+bool Connection::onResponse(std::string& response, bool reusable)
+{
+    if (response.empty()) {
+        return false;
+    }
+    if (!reusable) {
+        keepAlive = false;
+    }
+    outBuffer.clear();
+    outBuffer.swap(response);
+    outOffset = 0;
+    state = State::WritingResponse;
+    return flushOutput();
+}
+
+bool Connection::onExchangeDone(bool reusable)
+{
+    // The request is handled; its buffer waits for the next one
+    recycle(exchange->request);
+    bool keepOpen = onResponse(exchange->response, reusable);
+    recycle(exchange->response);
+    return keepOpen;
+}
+
+bool Connection::takeRequest(std::shared_ptr<RequestExchange>& exchange, bool& keepAlive)
+{
+    if (!requestReady) {
+        return false;
+    }
+    requestReady = false;
+
+    // The request moves to the exchange and the exchange's spare buffer
+    // becomes the input buffer, carrying anything pipelined behind it
+    size_t requestSize = headerEnd + contentLength;
+    std::string& spare = this->exchange->request;
+    spare.clear();
+    if (inBuffer.size() > requestSize) {
+        spare.append(inBuffer, requestSize, std::string::npos);
+        inBuffer.resize(requestSize);
+    }
+    inBuffer.swap(spare);
+    exchange = this->exchange;
+
+    requestsServed++;
+    if (requestsServed >= maxRequests) {
+        this->keepAlive = false;
+    }
+    keepAlive = this->keepAlive;
+    return true;
+}
+
+bool Connection::isStreaming() const
+{
+    return streaming;
+}
+
+// ----------------------------- State Machine --------------------------------->
+
+bool Connection::advance()
+{
+    if (state == State::ReadingHeaders && !parseHeaderBlock()) {
+        return false;
+    }
+
+    if (state == State::ReadingBody && (streaming || inBuffer.size() >= headerEnd + contentLength)) {
+        state = State::Processing;
+        requestReady = true;
+    }
+    return true;
+}
+
+bool Connection::parseHeaderBlock()
+{
+    // Only the bytes that arrived since the last call are scanned
+    size_t end = RequestParser::findHeaderEnd(inBuffer, headerScanned);
+    if (end == std::string::npos) {
+        headerScanned = inBuffer.size();
+        if (inBuffer.size() > MAX_HEADER_SIZE) {
+            std::cerr << COLOR_RED << "[Backend] Headers too large!" << COLOR_RESET << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    RequestHead head;
+    if (RequestParser::parse(std::string_view(inBuffer).substr(0, end), head) != RequestParser::Result::Complete) {
+        std::cerr << COLOR_RED << "[Backend] Malformed request head" << COLOR_RESET << std::endl;
+        return false;
+    }
+    headerEnd = head.size;
+
+    contentLength = 0;
+    if (head.has(HttpHeader::ContentLength)) {
+        if (!RequestParser::parseContentLength(head.get(HttpHeader::ContentLength), contentLength)) {
+            std::cerr << COLOR_RED << "[Backend] Invalid Content-Length header" << COLOR_RESET << std::endl;
+            return false;
+        }
+        if (contentLength > 0 && !isFrontend) {
+            std::cout << COLOR_YELLOW << "[Backend] Content-Length: " << contentLength << " bytes" << COLOR_RESET << std::endl;
+        }
+    }
+
+    // Bodies are only framed by Content-Length. A chunked one would be read
+    // as the next pipelined request, so the connection ends with the answer
+    if (head.has(HttpHeader::TransferEncoding)) {
+        std::cerr << COLOR_RED << "[Backend] Transfer-Encoding not supported" << COLOR_RESET << std::endl;
+        if (head.has(HttpHeader::ContentLength)) {
+            return rejectRequest(400, "Both Transfer-Encoding and Content-Length given");
+        }
+        return rejectRequest(501, "Transfer-Encoding not supported");
+    }
+
+    // HTTP/1.1 defaults to persistent connections, HTTP/1.0 has to ask for one
+    std::string_view connectionValue = head.get(HttpHeader::Connection);
+    keepAlive = head.isHttp11() ? !RequestParser::hasToken(connectionValue, "close")
+                                : RequestParser::hasToken(connectionValue, "keep-alive");
+
+    // The worker reads the rest of a raw or large form upload itself (only
+    // the backend takes uploads)
+    bool isPut = head.method == "PUT";
+    bool isPost = head.method == "POST";
+    streaming = !isFrontend && ((isPut && contentLength > 0) || (isPost && contentLength > STREAM_BODY_THRESHOLD));
+
+    state = State::ReadingBody;
+    if (streaming) {
+        // The slot covers the wait for a worker as well as the transfer itself
+        admission = UploadGovernor::instance().admitUpload(STREAMED_UPLOAD_MEMORY);
+        if (!admission.isValid()) {
+            std::cerr << COLOR_RED << "[Backend] Upload refused: server busy" << COLOR_RESET << std::endl;
+            return rejectRequest(503, "");
+        }
+        // The worker checks the size against storage and answers any Expect
+        return true;
+    }
+
+    // Anything else is buffered here, so refuse it before the body arrives
+    if (contentLength > STREAM_BODY_THRESHOLD) {
+        std::cerr << COLOR_RED << "[Backend] Request body too large!" << COLOR_RESET << std::endl;
+        return rejectRequest(413, "Request body too large");
+    }
+    if (contentLength > 0) {
+        // Held until the response is written, counted against the upload memory budget
+        admission = UploadGovernor::instance().reserveBuffer(headerEnd + contentLength);
+        if (!admission.isValid()) {
+            std::cerr << COLOR_RED << "[Backend] Upload memory budget exhausted" << COLOR_RESET << std::endl;
+            return rejectRequest(503, "");
+        }
+        // Grown once to the whole request, not step by step as the body arrives
+        inBuffer.reserve(headerEnd + contentLength);
+    }
+    if (head.has(HttpHeader::Expect)) {
+        if (!RequestParser::equalsIgnoreCase(head.get(HttpHeader::Expect), "100-continue")) {
+            return rejectRequest(417, "Expectation not supported");
+        }
+        if (inBuffer.size() < headerEnd + contentLength) {
+            // A lost interim response only costs the client its Expect timeout
+            static const char CONTINUE[] = "HTTP/1.1 100 Continue\r\n\r\n";
+            send(clientSocket, CONTINUE, sizeof(CONTINUE) - 1, 0);
+        }
+    }
+    return true;
+}
+
+bool Connection::rejectRequest(int statusCode, const std::string& message)
+{
+    std::string response;
+    HttpHandler handler(response, isFrontend);
+    if (statusCode == 503) {
+        handler.sendBusyResponse(UploadGovernor::instance().getRetryAfter());
+    } else {
+        handler.sendErrorResponse(statusCode, message);
+    }
+    state = State::Processing;
+    return onResponse(response, false);
+}
+
+bool Connection::flushOutput()
+{
+    while (outOffset < outBuffer.size()) {
+        ssize_t sent = send(clientSocket, outBuffer.data() + outOffset, outBuffer.size() - outOffset, 0);
+        if (sent > 0) {
+            outOffset += sent;
+            lastActivity = std::chrono::steady_clock::now();
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        return false;
+    }
+    return finishResponse();
+}
+
+bool Connection::finishResponse()
+{
+    if (!keepAlive) {
+        return false;
+    }
+
+    state = State::ReadingHeaders;
+    streaming = false;
+    headerEnd = 0;
+    headerScanned = 0;
+    contentLength = 0;
+    admission.release();
+    outOffset = 0;
+    recycle(outBuffer);
+
+    // Serve whatever was pipelined behind this request and resume draining the socket
+    return onReadable();
+}
@@ -0,0 +1,89 @@
+#ifndef CONNECTION_HPP
+#define CONNECTION_HPP
+
+#include "UploadGovernor.hpp"
+#include <string>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// What a worker gets to handle one request. It lives as long as the
+// connection (or the worker still using it) and is reused for every request.
+struct RequestExchange {
+    std::string request;
+    std::string response;
+};
+
+// Per-client state machine driven by the EventLoop. The socket is non-blocking,
+// so every handler reads or writes as much as the kernel allows and returns.
+// Persistent connections cycle back to ReadingHeaders after each response;
+// pipelined requests are buffered and answered strictly in order. Uploads
+// (any PUT, POSTs over 1MB) are handed over as soon as their headers arrive
+// so a worker can stream the body from the socket straight to disk.
+//
+// A connection's buffers are its arena: requests and responses trade
+// places with them by swapping rather than copying, so their capacity is
+// reused from one request to the next and a persistent connection settles
+// into allocating nothing for them. A buffered body is received straight
+// into the input buffer, reserved to the request's size once its head is read.
+class Connection
+{
+public:
+    Connection(int clientSocket, uint64_t id, size_t maxRequests, bool isFrontend);
+    ~Connection();
+
+    int getSocket() const;
+    uint64_t getId() const;
+
+    // All return false when the connection should be closed
+    bool onReadable();
+    bool onWritable();
+    // Takes the response over, leaving spare capacity behind in its place;
+    // reusable is false when the request body was not fully consumed
+    bool onResponse(std::string& response, bool reusable = true);
+    // Sends the response a worker left in the exchange
+    bool onExchangeDone(bool reusable);
+
+    // Hands over a fully received request exactly once, in the connection's
+    // exchange. For a streamed upload that is the headers plus whatever body
+    // arrived with them.
+    bool takeRequest(std::shared_ptr<RequestExchange>& exchange, bool& keepAlive);
+    bool isStreaming() const;
+
+    // Idle (or stalled) for longer than timeout while waiting on the client
+    bool isIdle(std::chrono::steady_clock::time_point now, std::chrono::seconds timeout) const;
+
+private:
+    enum class State { ReadingHeaders, ReadingBody, Processing, WritingResponse };
+
+    int clientSocket;
+    uint64_t id;
+    State state;
+    bool requestReady;
+    bool keepAlive;
+    bool isFrontend;
+    bool streaming;
+    size_t requestsServed;
+    size_t maxRequests;
+    std::chrono::steady_clock::time_point lastActivity;
+
+    std::string inBuffer;
+    size_t headerEnd;
+    size_t headerScanned;   // How much of inBuffer has been searched for the blank line
+    size_t contentLength;
+    UploadGovernor::Ticket admission;  // Upload slot or body buffer, held until the response is out
+
+    std::string outBuffer;
+    size_t outOffset;
+    std::shared_ptr<RequestExchange> exchange;
+
+    bool advance();
+    bool parseHeaderBlock();
+    // Answers with an error (503 adds Retry-After) and closes once it is written
+    bool rejectRequest(int statusCode, const std::string& message);
+    bool flushOutput();
+    bool finishResponse();
+};
+
+#endif // CONNECTION_HPP
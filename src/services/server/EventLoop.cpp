@@ -0,0 +1,391 @@
+#include "EventLoop.hpp"
+#include "Connection.hpp"
+#include "WorkerPool.hpp"
+#include "../http/HttpHandler.hpp"
+#include "../socket/Socket.hpp"
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <chrono>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#endif
+
+// Colors for terminal output
+#define COLOR_RED     "\033[0;31m"
+#define COLOR_RESET   "\033[0m"
+
+static const int MAX_EVENTS = 256;
+static const size_t ACCEPT_BATCH = 64;
+static const int SWEEP_INTERVAL_MS = 1000;
+
+// ----------------------------- Constructor/Destructor --------------------------------->
+
+EventLoop::EventLoop(int port, bool isFrontend, WorkerPool& workerPool, WorkerPool& uploadPool, const EventLoopSettings& settings)
+    : listener(new Socket(port, settings.sharded)),
+      isFrontend(isFrontend),
+      workerPool(workerPool),
+      uploadPool(uploadPool),
+      settings(settings),
+      pollFd(-1),
+      running(true),
+      nextConnectionId(1),
+      tasksInFlight(0)
+{
+    wakePipe[0] = wakePipe[1] = -1;
+
+    listener->listenSocket(settings.backlog);
+    listener->setNonBlocking();
+
+#ifdef __linux__
+    pollFd = epoll_create1(EPOLL_CLOEXEC);
+#else
+    pollFd = kqueue();
+#endif
+    if (pollFd == -1) {
+        throw std::runtime_error("Failed to create poller: " + std::string(strerror(errno)));
+    }
+
+    if (pipe(wakePipe) == -1) {
+        close(pollFd);
+        throw std::runtime_error("Failed to create wake pipe: " + std::string(strerror(errno)));
+    }
+    Socket::setNonBlocking(wakePipe[0]);
+    Socket::setNonBlocking(wakePipe[1]);
+
+    if (!watchDescriptor(wakePipe[0], false) || !watchDescriptor(listener->getServerSocket(), false)) {
+        close(wakePipe[0]);
+        close(wakePipe[1]);
+        close(pollFd);
+        throw std::runtime_error("Failed to register listener with poller");
+    }
+}
+
+EventLoop::~EventLoop()
+{
+    waitForWorkers();
+    connections.clear();
+    close(wakePipe[0]);
+    close(wakePipe[1]);
+    close(pollFd);
+}
+
+// ----------------------------- Run/Stop --------------------------------->
+
+void EventLoop::run()
+{
+    PollEvent events[MAX_EVENTS];
+    auto lastSweep = std::chrono::steady_clock::now();
+
+    while (running) {
+        int count = waitForEvents(events, MAX_EVENTS, SWEEP_INTERVAL_MS);
+        for (int i = 0; i < count && running; i++) {
+            handleEvent(events[i]);
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastSweep >= std::chrono::milliseconds(SWEEP_INTERVAL_MS)) {
+            closeIdleConnections();
+            lastSweep = now;
+        }
+    }
+
+    // Wake workers blocked on a streamed upload before their sockets close
+    for (const auto& entry : connections) {
+        shutdown(entry.first, SHUT_RDWR);
+    }
+    waitForWorkers();
+    connections.clear();
+}
+
+void EventLoop::waitForWorkers()
+{
+    // Workers still hold a reference to this loop until their tasks finish
+    std::unique_lock<std::mutex> lock(postedMutex);
+    drainedCondition.wait(lock, [this] { return tasksInFlight == 0; });
+}
+
+void EventLoop::stop()
+{
+    running = false;
+    // Async-signal-safe wake-up of a blocked poll
+    char signal = 1;
+    ssize_t ignored = write(wakePipe[1], &signal, 1);
+    (void)ignored;
+}
+
+void EventLoop::post(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(postedMutex);
+        postedTasks.push_back(std::move(task));
+    }
+    char signal = 1;
+    ssize_t ignored = write(wakePipe[1], &signal, 1);
+    (void)ignored;
+}
+
+void EventLoop::runPostedTasks()
+{
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(postedMutex);
+        tasks.swap(postedTasks);
+    }
+    for (auto& task : tasks) {
+        task();
+    }
+}
+
+// ----------------------------- Event Dispatch --------------------------------->
+
+void EventLoop::handleEvent(const PollEvent& event)
+{
+    if (event.fd == wakePipe[0]) {
+        char drain[64];
+        while (read(wakePipe[0], drain, sizeof(drain)) > 0) {}
+        runPostedTasks();
+        return;
+    }
+
+    if (event.fd == listener->getServerSocket()) {
+        acceptConnections();
+        return;
+    }
+
+    auto it = connections.find(event.fd);
+    if (it == connections.end()) {
+        return;
+    }
+
+    Connection& connection = *it->second;
+    bool keepOpen = !event.failed;
+    if (keepOpen && event.readable) {
+        keepOpen = connection.onReadable();
+    }
+    if (keepOpen && event.writable) {
+        keepOpen = connection.onWritable();
+    }
+    if (!keepOpen) {
+        closeConnection(event.fd);
+        return;
+    }
+    serviceConnection(connection);
+}
+
+void EventLoop::serviceConnection(Connection& connection)
+{
+    std::shared_ptr<RequestExchange> exchange;
+    bool keepAlive = false;
+    if (connection.takeRequest(exchange, keepAlive)) {
+        dispatchRequest(connection, std::move(exchange), keepAlive);
+    }
+}
+
+void EventLoop::acceptConnections()
+{
+    int clients[ACCEPT_BATCH];
+
+    // Edge-triggered: accept until the backlog is empty
+    while (true) {
+        size_t count = listener->acceptBatch(clients, ACCEPT_BATCH);
+        int acceptError = errno;
+
+        for (size_t i = 0; i < count; i++) {
+            std::unique_ptr<Connection> connection(new Connection(clients[i], nextConnectionId++, settings.keepAliveMaxRequests, isFrontend));
+            if (watchDescriptor(clients[i], true)) {
+                connections[clients[i]] = std::move(connection);
+            }
+        }
+
+        if (count < ACCEPT_BATCH) {
+            if (acceptError != EAGAIN && acceptError != EWOULDBLOCK) {
+                std::cerr << COLOR_RED << "[" << (isFrontend ? "Frontend" : "Backend") << "] Accept failed: "
+                          << strerror(acceptError) << COLOR_RESET << std::endl;
+            }
+            return;
+        }
+    }
+}
+
+void EventLoop::closeConnection(int fd)
+{
+    unwatchDescriptor(fd);
+    connections.erase(fd);
+}
+
+void EventLoop::closeIdleConnections()
+{
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::seconds timeout(settings.keepAliveTimeout);
+
+    std::vector<int> idle;
+    for (const auto& entry : connections) {
+        if (entry.second->isIdle(now, timeout)) {
+            idle.push_back(entry.first);
+        }
+    }
+    for (int fd : idle) {
+        closeConnection(fd);
+    }
+}
+
+// ----------------------------- Request Dispatch --------------------------------->
+
+void EventLoop::dispatchRequest(Connection& connection, std::shared_ptr<RequestExchange> exchange, bool keepAlive)
+{
+    int fd = connection.getSocket();
+    uint64_t id = connection.getId();
+
+    bool streamed = connection.isStreaming();
+    if (streamed) {
+        // The worker owns the socket until the upload is on disk
+        unwatchDescriptor(fd);
+        Socket::setBlocking(fd);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(postedMutex);
+        tasksInFlight++;
+    }
+
+    WorkerPool& pool = streamed ? uploadPool : workerPool;
+    pool.submit([this, fd, id, exchange, keepAlive, streamed]() {
+        // The connection owns these buffers again once the response is posted
+        std::string& response = exchange->response;
+        bool reusable = true;
+        try {
+            HttpHandler handler(response, isFrontend, keepAlive);
+            if (streamed) {
+                reusable = handler.handleStreamedUpload(fd, exchange->request);
+            } else {
+                handler.handleRequest(exchange->request);
+            }
+        } catch (const std::exception& e) {
+            // An empty response closes the connection
+            std::cerr << COLOR_RED << "[" << (isFrontend ? "Frontend" : "Backend") << "] Request failed: "
+                      << e.what() << COLOR_RESET << std::endl;
+            response.clear();
+        }
+
+        post([this, fd, id, streamed, reusable]() {
+            completeRequest(fd, id, streamed, reusable);
+        });
+
+        std::lock_guard<std::mutex> lock(postedMutex);
+        tasksInFlight--;
+        drainedCondition.notify_all();
+    });
+}
+
+void EventLoop::completeRequest(int fd, uint64_t id, bool streamed, bool reusable)
+{
+    // The client may have gone away (and its fd been reused) meanwhile
+    auto it = connections.find(fd);
+    if (it == connections.end() || it->second->getId() != id) {
+        return;
+    }
+
+    if (streamed) {
+        Socket::setNonBlocking(fd);
+        if (!watchDescriptor(fd, true)) {
+            closeConnection(fd);
+            return;
+        }
+    }
+
+    if (!it->second->onExchangeDone(reusable)) {
+        closeConnection(fd);
+        return;
+    }
+    serviceConnection(*it->second);
+}
+
+// ----------------------------- Poller Backend --------------------------------->
+
+#ifdef __linux__
+
+bool EventLoop::watchDescriptor(int fd, bool withWrite)
+{
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLET | (withWrite ? (EPOLLOUT | EPOLLRDHUP) : 0);
+    ev.data.fd = fd;
+    return epoll_ctl(pollFd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+void EventLoop::unwatchDescriptor(int fd)
+{
+    epoll_ctl(pollFd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+int EventLoop::waitForEvents(PollEvent* events, int maxEvents, int timeoutMs)
+{
+    epoll_event ready[MAX_EVENTS];
+    int count = epoll_wait(pollFd, ready, std::min(maxEvents, MAX_EVENTS), timeoutMs);
+    if (count < 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < count; i++) {
+        events[i].fd = ready[i].data.fd;
+        events[i].readable = ready[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP);
+        events[i].writable = ready[i].events & EPOLLOUT;
+        events[i].failed = ready[i].events & EPOLLERR;
+    }
+    return count;
+}
+
+#else
+
+bool EventLoop::watchDescriptor(int fd, bool withWrite)
+{
+    struct kevent changes[2];
+    int count = 0;
+    EV_SET(&changes[count++], fd, EVFILT_READ, EV_ADD | EV_CLEAR, 0, 0, nullptr);
+    if (withWrite) {
+        EV_SET(&changes[count++], fd, EVFILT_WRITE, EV_ADD | EV_CLEAR, 0, 0, nullptr);
+    }
+    return kevent(pollFd, changes, count, nullptr, 0, nullptr) == 0;
+}
+
+void EventLoop::unwatchDescriptor(int fd)
+{
+    // Needed for sockets handed to a worker; closed ones drop their filters anyway
+    struct kevent changes[2];
+    EV_SET(&changes[0], fd, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+    EV_SET(&changes[1], fd, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+    kevent(pollFd, changes, 2, nullptr, 0, nullptr);
+}
+
+int EventLoop::waitForEvents(PollEvent* events, int maxEvents, int timeoutMs)
+{
+    struct kevent ready[MAX_EVENTS];
+    struct timespec timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+
+    int count = kevent(pollFd, nullptr, 0, ready, std::min(maxEvents, MAX_EVENTS), timeoutMs < 0 ? nullptr : &timeout);
+    if (count < 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < count; i++) {
+        events[i].fd = static_cast<int>(ready[i].ident);
+        events[i].readable = ready[i].filter == EVFILT_READ;
+        events[i].writable = ready[i].filter == EVFILT_WRITE;
+        events[i].failed = ready[i].flags & EV_ERROR;
+    }
+    return count;
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef EVENT_LOOP_HPP
+#define EVENT_LOOP_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Socket;
+class Connection;
+struct RequestExchange;
+class WorkerPool;
+
+struct EventLoopSettings {
+    int backlog;
+    bool sharded;                 // Bind with SO_REUSEPORT alongside sibling loops
+    int keepAliveTimeout;         // Seconds a persistent connection may sit idle
+    size_t keepAliveMaxRequests;  // Requests served before the connection is closed
+};
+
+// Non-blocking, edge-triggered reactor (epoll on Linux, kqueue elsewhere).
+// Owns one listening Socket and every Connection accepted from it; complete
+// requests are handled on the WorkerPool and their responses posted back.
+// Streamed upload bodies, which hold a thread for the whole transfer, run on
+// a pool of their own so they never keep requests from being handled.
+// Sharded loops each bind their own SO_REUSEPORT socket to the same port.
+class EventLoop
+{
+public:
+    EventLoop(int port, bool isFrontend, WorkerPool& workerPool, WorkerPool& uploadPool, const EventLoopSettings& settings);
+    ~EventLoop();
+
+    void run();
+    void stop();
+
+    // Thread-safe: queue a task to run on the loop thread
+    void post(std::function<void()> task);
+
+private:
+    struct PollEvent {
+        int fd;
+        bool readable;
+        bool writable;
+        bool failed;
+    };
+
+    std::unique_ptr<Socket> listener;
+    bool isFrontend;
+    WorkerPool& workerPool;
+    WorkerPool& uploadPool;
+    EventLoopSettings settings;
+    int pollFd;
+    int wakePipe[2];
+    std::atomic<bool> running;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    uint64_t nextConnectionId;
+
+    std::mutex postedMutex;
+    std::condition_variable drainedCondition;
+    std::vector<std::function<void()>> postedTasks;
+    size_t tasksInFlight;
+
+    void acceptConnections();
+    void handleEvent(const PollEvent& event);
+    void closeConnection(int fd);
+    void serviceConnection(Connection& connection);
+    void closeIdleConnections();
+    void runPostedTasks();
+
+    void dispatchRequest(Connection& connection, std::shared_ptr<RequestExchange> exchange, bool keepAlive);
+    void completeRequest(int fd, uint64_t id, bool streamed, bool reusable);
+    void waitForWorkers();
+
+    // Poller backend
+    bool watchDescriptor(int fd, bool withWrite);
+    void unwatchDescriptor(int fd);
+    int waitForEvents(PollEvent* events, int maxEvents, int timeoutMs);
+};
+
+#endif // EVENT_LOOP_HPP
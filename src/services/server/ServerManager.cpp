@@ -1,7 +1,15 @@
 #include "ServerManager.hpp"
+#include "EventLoop.hpp"
+#include "WorkerPool.hpp"
+#include "UploadGovernor.hpp"
+#include "../storage/FileReceiver.hpp"
+#include "../storage/Sha256.hpp"
+#include "../storage/UploadWriter.hpp"
 #include "../socket/Socket.hpp"
 #include "../http/HttpHandler.hpp"
+#include "../http/RequestParser.hpp"
 #include "../config/ConfigManager.hpp"
+#include "../config/ConfigWatcher.hpp"
 #include <iostream>
 #include <thread>
 #include <sys/socket.h>
@@ -13,6 +21,11 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <chrono>
+#include <algorithm>
+#include <pthread.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
 
 // Colors for terminal output
 #define COLOR_RED     "\033[0;31m"
@@ -22,8 +35,6 @@
 #define COLOR_CYAN    "\033[0;36m"
 #define COLOR_RESET   "\033[0m"
 
-#define FRONTEND_PORT 3000
-#define BACKEND_PORT 8080
 #define CONTROL_PORT 8081
 
 std::atomic<bool> ServerManager::serverRunning(true);
@@ -58,10 +69,41 @@ std::string ServerManager::getLocalIpAddress() {
     return "127.0.0.1"; // Fallback
 }
 
-ServerManager::ServerManager() : frontendSocket(nullptr), backendSocket(nullptr), controlSocket(nullptr) {}
+// Keep each acceptor shard on its own core so its socket's queue stays cache-local.
+// Slots count through the CPUs this process may run on (a cpuset or taskset
+// can leave gaps), not through all the machine's cores
+static void pinCurrentThread(size_t slot) {
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+    size_t count = static_cast<size_t>(CPU_COUNT(&allowed));
+    if (count == 0) return;
+
+    size_t wanted = slot % count;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) continue;
+        if (wanted > 0) {
+            wanted--;
+            continue;
+        }
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(cpu, &cpuSet);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+        return;
+    }
+#else
+    (void)slot;
+#endif
+}
+
+ServerManager::ServerManager() : uploadThreads(0), controlSocket(nullptr), frontendPort(0), backendPort(0), listenBacklog(Socket::DEFAULT_BACKLOG),
+    acceptShards(1), keepAliveTimeout(15), keepAliveMaxRequests(1000) {}
 
 ServerManager::~ServerManager() {
     stopAllServers();
+    joinListeners();
 }
 
 void ServerManager::setServerRunning(bool running) {
@@ -73,12 +115,22 @@ bool ServerManager::isServerRunning() {
 }
 
 void ServerManager::startAllServers() {
+    // Requests read storage settings from the current snapshot, so a reload
+    // reaches them at once; upload admission is reapplied here, and ports and
+    // listener settings apply the next time the main servers start
+    configWatcher.reset(new ConfigWatcher([this](const ConfigManager& config) {
+        applyUploadLimits(config);
+    }));
+    configWatcher->start();
+
     std::thread controlThread(&ServerManager::runControlServer, this);
     controlThread.detach(); 
 
     while(serverRunning) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
     }
+    configWatcher->stop();
+    joinListeners();
 
     std::cout << COLOR_GREEN << "All servers stopped ✅" << COLOR_RESET << std::endl;
 }
@@ -93,22 +145,69 @@ void ServerManager::startMainServers() {
     std::cout << COLOR_BLUE << "========================================" << COLOR_RESET << std::endl;
     std::cout << COLOR_BLUE << "  Starting RapidComm File Upload Server" << COLOR_RESET << std::endl;
     std::cout << COLOR_BLUE << "========================================" << COLOR_RESET << std::endl;
-    std::cout << COLOR_GREEN << "Frontend: http://" << getLocalIpAddress() << ":" << FRONTEND_PORT << COLOR_RESET << std::endl;
-    std::cout << COLOR_GREEN << "Backend:  http://localhost:" << BACKEND_PORT << COLOR_RESET << std::endl;
-    ConfigManager config;
-    std::cout << COLOR_CYAN << "Storage:  " << config.getStorageDirectory() << COLOR_RESET << std::endl;
+    std::shared_ptr<const ConfigManager> config = ConfigManager::current();
+    frontendPort = config->getFrontendPort();
+    backendPort = config->getBackendPort();
+    std::cout << COLOR_GREEN << "Frontend: http://" << getLocalIpAddress() << ":" << frontendPort << COLOR_RESET << std::endl;
+    std::cout << COLOR_GREEN << "Backend:  http://localhost:" << backendPort << COLOR_RESET << std::endl;
+    std::cout << COLOR_CYAN << "Storage:  " << config->getStorageDirectory() << COLOR_RESET << std::endl;
+    // No upload is running yet, so whatever is in the temporary directory was left by a crash
+    UploadWriter::removeTemporaryFiles(config->getStorageDirectory());
+
+    listenBacklog = config->getListenBacklog();
+    acceptShards = config->getAcceptShards();
+    if (acceptShards == 0) {
+        acceptShards = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (!Socket::supportsReusePort()) {
+        acceptShards = 1;
+    }
+    keepAliveTimeout = config->getKeepAliveTimeout();
+    keepAliveMaxRequests = std::max<size_t>(1, config->getKeepAliveMaxRequests());
+
+    // Request handling is shared by both listeners and survives restarts
+    if (!workerPool) {
+        workerPool.reset(new WorkerPool());
+        // A thread per admitted upload, so slow uploaders only ever wait on each other
+        uploadPool.reset(new WorkerPool(std::max<size_t>(1, config->getMaxConcurrentUploads())));
+        uploadThreads = uploadPool->size();
+        std::cout << COLOR_CYAN << "[Main] Worker pool: " << workerPool->size() << " threads" << COLOR_RESET << std::endl;
+        std::cout << COLOR_CYAN << "[Main] Upload pool: " << uploadPool->size() << " threads" << COLOR_RESET << std::endl;
+        std::cout << COLOR_CYAN << "[Main] Upload I/O: " << FileReceiver::backendName(config->isIoUringEnabled()) << COLOR_RESET << std::endl;
+        std::cout << COLOR_CYAN << "[Main] Integrity: sha256 (" << Sha256::implementationName() << ")" << COLOR_RESET << std::endl;
+    }
+
+    applyUploadLimits(*config);
     std::cout << COLOR_BLUE << "========================================" << COLOR_RESET << std::endl;
     std::cout.flush();
 
     try {
-        std::thread frontendThread(&ServerManager::runFrontendServer, this);
-        std::thread backendThread(&ServerManager::runBackendServer, this);
-        frontendThread.detach();
-        backendThread.detach();
+        std::lock_guard<std::mutex> lock(listenersMutex);
+        for (size_t shard = 0; shard < acceptShards; shard++) {
+            listenerThreads.emplace_back(&ServerManager::runListener, this, frontendPort, true, shard);
+            listenerThreads.emplace_back(&ServerManager::runListener, this, backendPort, false, shard);
+        }
     } catch (const std::exception& e) {
         std::cerr << "[Main] Error starting main servers: " << e.what() << std::endl;
-        mainServerRunning = false;
+        stopListeners();
+        joinListeners();
+    }
+}
+
+void ServerManager::applyUploadLimits(const ConfigManager& config) {
+    // An admitted upload must find a free thread at once: one left queued
+    // would hold its slot with nobody reading its socket. The upload pool
+    // is sized once per process, so a limit above it waits for a restart
+    size_t concurrent = config.getMaxConcurrentUploads();
+    size_t threads = uploadThreads;
+    if (threads > 0 && concurrent > threads) {
+        std::cout << COLOR_YELLOW << "[Main] MAX_CONCURRENT_UPLOADS=" << concurrent << " exceeds the " << threads
+                  << " upload threads; using " << threads << " until the process restarts" << COLOR_RESET << std::endl;
+        concurrent = threads;
     }
+    UploadGovernor::instance().configure(concurrent, config.getUploadMemoryBudget(), config.getUploadRetryAfter());
+    std::cout << COLOR_CYAN << "Uploads:  " << concurrent << " concurrent, "
+              << config.getUploadMemoryBudget() / (1024 * 1024) << " MB buffer budget" << COLOR_RESET << std::endl;
 }
 
 void ServerManager::stopMainServers() {
@@ -116,22 +215,36 @@ void ServerManager::stopMainServers() {
         std::cout << COLOR_YELLOW << "Main servers are not running." << COLOR_RESET << std::endl;
         return;
     }
-    mainServerRunning = false;
+    std::cout << COLOR_GREEN << "Main servers stopping..." << COLOR_RESET << std::endl;
 
-    if (frontendSocket) {
-        close(frontendSocket->getServerSocket());
-        frontendSocket = nullptr;
+    // Wait for the listening sockets to close, so a start right after this
+    // can bind the same ports again
+    stopListeners();
+    joinListeners();
+    std::cout << COLOR_GREEN << "Main servers stopped" << COLOR_RESET << std::endl;
+}
+
+void ServerManager::stopListeners() {
+    mainServerRunning = false;
+    std::lock_guard<std::mutex> lock(loopsMutex);
+    for (EventLoop* loop : activeLoops) {
+        loop->stop();
     }
-    if (backendSocket) {
-        close(backendSocket->getServerSocket());
-        backendSocket = nullptr;
+}
+
+void ServerManager::joinListeners() {
+    std::lock_guard<std::mutex> lock(listenersMutex);
+    for (std::thread& thread : listenerThreads) {
+        thread.join();
     }
-    std::cout << COLOR_GREEN << "Main servers stopping..." << COLOR_RESET << std::endl;
+    listenerThreads.clear();
 }
 
 void ServerManager::stopAllServers() {
+    // Also runs from the signal handler, which may interrupt a listener
+    // thread, so the listeners are joined once the main loop sees this
     serverRunning = false;
-    stopMainServers();
+    stopListeners();
     if (controlSocket) {
         close(controlSocket->getServerSocket());
         controlSocket = nullptr;
@@ -155,8 +268,10 @@ void ServerManager::runControlServer() {
 
             HttpHandler handler(clientSocket, false);
             std::string request = handler.parseRequest();
-            std::string method = handler.extractMethod(request);
-            std::string route = handler.extractRoute(request);
+            RequestHead head;
+            RequestParser::parse(request, head);
+            std::string_view method = head.method;
+            std::string_view route = head.target;
             
             // Required for CORS
             if (method == "OPTIONS") {
@@ -186,76 +301,50 @@ void ServerManager::runControlServer() {
     }
 }
 
-void ServerManager::runFrontendServer() {
-    try {
-        Socket frontendServer(FRONTEND_PORT);
-        frontendSocket = &frontendServer;
-        frontendServer.listenSocket();
-        
-        std::cout << COLOR_GREEN << "[Frontend] Server started on port " << FRONTEND_PORT << COLOR_RESET << std::endl;
-        std::cout.flush();
-        
-        while (mainServerRunning) {
-            int clientSocket = accept(frontendServer.getServerSocket(), nullptr, nullptr);
-            
-            if (clientSocket == -1) {
-                if (mainServerRunning) {
-                    std::cerr << "[Frontend] Accept failed: " << strerror(errno) << std::endl;
-                }
-                break;
-            }
-            
-            if (!mainServerRunning) {
-                close(clientSocket);
-                break;
-            };
-            
-            HttpHandler httpHandler(clientSocket, true);
-            httpHandler.handleRequest();
-             close(clientSocket);
-        }
-        
-        frontendSocket = nullptr;
-        std::cout << COLOR_GREEN << "Frontend stopped" << COLOR_RESET << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "[Frontend] Server error: " << e.what() << std::endl;
-        frontendSocket = nullptr;
+void ServerManager::runListener(int port, bool isFrontend, size_t shard) {
+    const char* name = isFrontend ? "Frontend" : "Backend";
+    bool sharded = acceptShards > 1;
+    if (sharded) {
+        // Shard N of both listeners shares core N: with the default of a
+        // shard per core, each core then accepts for both ports once, where
+        // offsetting the backend would only wrap it onto another frontend shard
+        pinCurrentThread(shard);
     }
-}
 
-void ServerManager::runBackendServer() {
+    EventLoopSettings settings;
+    settings.backlog = listenBacklog;
+    settings.sharded = sharded;
+    settings.keepAliveTimeout = keepAliveTimeout;
+    settings.keepAliveMaxRequests = keepAliveMaxRequests;
+
     try {
-        Socket backendServer(BACKEND_PORT);
-        backendSocket = &backendServer;
-        backendServer.listenSocket();
-        
-        std::cout << COLOR_GREEN << "[Backend] Server started on port " << BACKEND_PORT << COLOR_RESET << std::endl;
-        std::cout.flush();
+        EventLoop server(port, isFrontend, *workerPool, *uploadPool, settings);
+        {
+            std::lock_guard<std::mutex> lock(loopsMutex);
+            activeLoops.push_back(&server);
+        }
         
-        while (mainServerRunning) {
-            int clientSocket = accept(backendServer.getServerSocket(), nullptr, nullptr);
-            
-            if (clientSocket == -1) {
-                if (mainServerRunning) {
-                    std::cerr << "[Backend] Accept failed: " << strerror(errno) << std::endl;
-                }
-                break;
+        if (shard == 0) {
+            std::cout << COLOR_GREEN << "[" << name << "] Server started on port " << port;
+            if (sharded) {
+                std::cout << " (" << acceptShards << " acceptor shards)";
             }
-            
-             if (!mainServerRunning) {
-                close(clientSocket);
-                break;
-            };
-            
-            HttpHandler httpHandler(clientSocket, false);
-            httpHandler.handleRequest();
-             close(clientSocket);
+            std::cout << COLOR_RESET << std::endl;
+            std::cout.flush();
+        }
+        
+        if (mainServerRunning) {
+            server.run();
         }
         
-        backendSocket = nullptr;
-        std::cout << COLOR_GREEN << "Backend stopped" << COLOR_RESET << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(loopsMutex);
+            activeLoops.erase(std::remove(activeLoops.begin(), activeLoops.end(), &server), activeLoops.end());
+        }
+        if (shard == 0) {
+            std::cout << COLOR_GREEN << name << " stopped" << COLOR_RESET << std::endl;
+        }
     } catch (const std::exception& e) {
-        std::cerr << "[Backend] Server error: " << e.what() << std::endl;
-        backendSocket = nullptr;
+        std::cerr << "[" << name << "] Server error: " << e.what() << std::endl;
     }
 }
@@ -2,9 +2,17 @@
 #define SERVER_MANAGER_HPP
 
 #include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 class Socket;
+class EventLoop;
+class WorkerPool;
+class ConfigWatcher;
+class ConfigManager;
 
 class ServerManager {
 public:
@@ -21,15 +29,30 @@ public:
     static void setServerRunning(bool running);
 
 private:
-    void runFrontendServer();
-    void runBackendServer();
+    void runListener(int port, bool isFrontend, size_t shard);
+    void stopListeners();
+    void joinListeners();
     void runControlServer();
     std::string getLocalIpAddress();
-
-    Socket* frontendSocket;
-    Socket* backendSocket;
+    void applyUploadLimits(const ConfigManager& config);
+
+    std::unique_ptr<WorkerPool> workerPool;
+    std::unique_ptr<WorkerPool> uploadPool;
+    std::atomic<size_t> uploadThreads; // uploadPool's size, 0 until it exists
+    std::unique_ptr<ConfigWatcher> configWatcher;
+    std::mutex loopsMutex;
+    std::vector<EventLoop*> activeLoops;
+    std::mutex listenersMutex;
+    std::vector<std::thread> listenerThreads;
     Socket* controlSocket;
 
+    int frontendPort;
+    int backendPort;
+    int listenBacklog;
+    size_t acceptShards;
+    int keepAliveTimeout;
+    size_t keepAliveMaxRequests;
+
     static std::atomic<bool> serverRunning;
     static std::atomic<bool> mainServerRunning;
 };
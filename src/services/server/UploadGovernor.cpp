@@ -0,0 +1,133 @@
+#include "UploadGovernor.hpp"
+#include <algorithm>
+
+static const size_t DEFAULT_MAX_UPLOADS = 10;
+static const size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024; // 256MB
+static const int DEFAULT_RETRY_AFTER = 5; // seconds
+
+// ----------------------------- Ticket --------------------------------->
+
+UploadGovernor::Ticket::Ticket()
+    : governor(nullptr), slot(false), bytes(0)
+{
+}
+
+UploadGovernor::Ticket::Ticket(UploadGovernor* governor, bool slot, size_t bytes)
+    : governor(governor), slot(slot), bytes(bytes)
+{
+}
+
+UploadGovernor::Ticket::Ticket(Ticket&& other) noexcept
+    : governor(other.governor), slot(other.slot), bytes(other.bytes)
+{
+    other.governor = nullptr;
+}
+
+UploadGovernor::Ticket& UploadGovernor::Ticket::operator=(Ticket&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        governor = other.governor;
+        slot = other.slot;
+        bytes = other.bytes;
+        other.governor = nullptr;
+    }
+    return *this;
+}
+
+UploadGovernor::Ticket::~Ticket()
+{
+    release();
+}
+
+bool UploadGovernor::Ticket::isValid() const
+{
+    return governor != nullptr;
+}
+
+void UploadGovernor::Ticket::release()
+{
+    if (governor) {
+        governor->giveBack(slot, bytes);
+        governor = nullptr;
+    }
+}
+
+// ----------------------------- UploadGovernor --------------------------------->
+
+UploadGovernor::UploadGovernor()
+    : maxUploads(DEFAULT_MAX_UPLOADS),
+      memoryBudget(DEFAULT_MEMORY_BUDGET),
+      retryAfter(DEFAULT_RETRY_AFTER),
+      activeUploads(0),
+      bufferedBytes(0)
+{
+}
+
+UploadGovernor& UploadGovernor::instance()
+{
+    static UploadGovernor governor;
+    return governor;
+}
+
+void UploadGovernor::configure(size_t maxUploads, size_t memoryBudget, int retryAfter)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    this->maxUploads = std::max<size_t>(1, maxUploads);
+    this->memoryBudget = memoryBudget;
+    this->retryAfter = std::max(1, retryAfter);
+}
+
+UploadGovernor::Ticket UploadGovernor::admitUpload(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!fits(true, bytes)) {
+        return Ticket();
+    }
+    activeUploads++;
+    bufferedBytes += bytes;
+    return Ticket(this, true, bytes);
+}
+
+UploadGovernor::Ticket UploadGovernor::reserveBuffer(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!fits(false, bytes)) {
+        return Ticket();
+    }
+    bufferedBytes += bytes;
+    return Ticket(this, false, bytes);
+}
+
+int UploadGovernor::getRetryAfter() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return retryAfter;
+}
+
+size_t UploadGovernor::getActiveUploads() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return activeUploads;
+}
+
+size_t UploadGovernor::getBufferedBytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return bufferedBytes;
+}
+
+bool UploadGovernor::fits(bool slot, size_t bytes) const
+{
+    if (slot && activeUploads >= maxUploads) {
+        return false;
+    }
+    return bytes <= memoryBudget && bufferedBytes <= memoryBudget - bytes;
+}
+
+void UploadGovernor::giveBack(bool slot, size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slot) activeUploads--;
+    bufferedBytes -= bytes;
+}
@@ -0,0 +1,65 @@
+#ifndef UPLOAD_GOVERNOR_HPP
+#define UPLOAD_GOVERNOR_HPP
+
+#include <cstddef>
+#include <mutex>
+
+// Server-wide admission control for uploads. Every in-flight upload holds a
+// slot (MAX_CONCURRENT_UPLOADS) and a reservation for the bytes it keeps in
+// memory, drawn from one shared budget. Admission never blocks: when either
+// runs out the upload is turned away with 503 and Retry-After, so a burst of
+// large uploads is shed instead of exhausting memory. Admitted uploads that
+// are waiting for a worker keep their slot, so the pool queue stays bounded.
+class UploadGovernor
+{
+public:
+    // Returns its slot and bytes when destroyed
+    class Ticket
+    {
+    public:
+        Ticket();
+        Ticket(Ticket&& other) noexcept;
+        Ticket& operator=(Ticket&& other) noexcept;
+        ~Ticket();
+
+        bool isValid() const;
+        void release();
+
+    private:
+        friend class UploadGovernor;
+        Ticket(UploadGovernor* governor, bool slot, size_t bytes);
+
+        UploadGovernor* governor;
+        bool slot;
+        size_t bytes;
+    };
+
+    static UploadGovernor& instance();
+
+    void configure(size_t maxUploads, size_t memoryBudget, int retryAfter);
+
+    // Upload slot plus bytes of buffer; an invalid ticket means refuse
+    Ticket admitUpload(size_t bytes);
+    // Bytes of buffer only, for request bodies that are not uploads themselves
+    Ticket reserveBuffer(size_t bytes);
+
+    // Seconds a refused client should wait before retrying
+    int getRetryAfter() const;
+    size_t getActiveUploads() const;
+    size_t getBufferedBytes() const;
+
+private:
+    UploadGovernor();
+
+    mutable std::mutex mutex;
+    size_t maxUploads;
+    size_t memoryBudget;
+    int retryAfter;
+    size_t activeUploads;
+    size_t bufferedBytes;
+
+    bool fits(bool slot, size_t bytes) const;
+    void giveBack(bool slot, size_t bytes);
+};
+
+#endif // UPLOAD_GOVERNOR_HPP
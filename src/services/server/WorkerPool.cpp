@@ -0,0 +1,122 @@
+#include "WorkerPool.hpp"
+#include <iostream>
+
+// Colors for terminal output
+#define COLOR_RED     "\033[0;31m"
+#define COLOR_RESET   "\033[0m"
+
+// Identifies the pool and deque owned by the calling thread, if any
+static thread_local WorkerPool* currentPool = nullptr;
+static thread_local size_t currentWorker = 0;
+
+// ----------------------------- Constructor/Destructor --------------------------------->
+
+WorkerPool::WorkerPool(size_t threadCount)
+    : nextWorker(0),
+      pendingTasks(0),
+      stopping(false)
+{
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    if (threadCount == 0) {
+        threadCount = 4;
+    }
+
+    for (size_t i = 0; i < threadCount; i++) {
+        workers.emplace_back(new Worker());
+    }
+    for (size_t i = 0; i < threadCount; i++) {
+        threads.emplace_back(&WorkerPool::workerLoop, this, i);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// ----------------------------- Task Submission --------------------------------->
+
+void WorkerPool::submit(Task task)
+{
+    // Tasks spawned by a worker stay on its own deque for locality
+    size_t index = (currentPool == this) ? currentWorker : nextWorker++ % workers.size();
+
+    // Count first so a worker never sees a task it has not been told about
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        pendingTasks++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(workers[index]->mutex);
+        workers[index]->tasks.push_back(std::move(task));
+    }
+    wakeCondition.notify_one();
+}
+
+size_t WorkerPool::size() const
+{
+    return workers.size();
+}
+
+// ----------------------------- Worker Loop --------------------------------->
+
+void WorkerPool::workerLoop(size_t index)
+{
+    currentPool = this;
+    currentWorker = index;
+
+    while (true) {
+        Task task;
+        if (popLocal(index, task) || stealTask(index, task)) {
+            pendingTasks--;
+            try {
+                task();
+            } catch (const std::exception& e) {
+                std::cerr << COLOR_RED << "[Worker] Task failed: " << e.what() << COLOR_RESET << std::endl;
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeCondition.wait(lock, [this] { return stopping || pendingTasks > 0; });
+        if (stopping && pendingTasks == 0) {
+            return;
+        }
+    }
+}
+
+bool WorkerPool::popLocal(size_t index, Task& task)
+{
+    Worker& worker = *workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) {
+        return false;
+    }
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    return true;
+}
+
+bool WorkerPool::stealTask(size_t thief, Task& task)
+{
+    for (size_t offset = 1; offset < workers.size(); offset++) {
+        Worker& victim = *workers[(thief + offset) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
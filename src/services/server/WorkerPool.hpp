@@ -0,0 +1,47 @@
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool with one deque per worker. Workers pop their own deque from
+// the back and steal from the front of their peers' deques when idle.
+class WorkerPool
+{
+public:
+    using Task = std::function<void()>;
+
+    // threadCount == 0 sizes the pool to the machine's cores
+    explicit WorkerPool(size_t threadCount = 0);
+    ~WorkerPool();
+
+    void submit(Task task);
+    size_t size() const;
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> nextWorker;
+    std::atomic<size_t> pendingTasks;
+    std::atomic<bool> stopping;
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeCondition;
+
+    void workerLoop(size_t index);
+    bool popLocal(size_t index, Task& task);
+    bool stealTask(size_t thief, Task& task);
+};
+
+#endif // WORKER_POOL_HPP
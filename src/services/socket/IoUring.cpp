@@ -0,0 +1,260 @@
+#include "IoUring.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef RAPIDCOMM_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// ----------------------------- Constructor/Destructor --------------------------------->
+
+IoUring::IoUring(unsigned entries)
+    : ringFd(-1),
+      sqEntries(0),
+      pendingSubmissions(0),
+      sqRing(nullptr), sqRingSize(0),
+      cqRing(nullptr), cqRingSize(0),
+      sqeArray(nullptr), sqeArraySize(0),
+      sqHead(nullptr), sqTail(nullptr), sqMask(nullptr), sqArray(nullptr),
+      cqHead(nullptr), cqTail(nullptr), cqMask(nullptr), cqes(nullptr)
+{
+#ifdef RAPIDCOMM_HAVE_IO_URING
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ringFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (ringFd < 0) {
+        ringFd = -1;
+        return;
+    }
+    sqEntries = params.sq_entries;
+    timeouts.assign(sqEntries * 2, 0);
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+    }
+
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        sqRing = nullptr;
+        release();
+        return;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cqRing = sqRing;
+    } else {
+        cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            cqRing = nullptr;
+            release();
+            return;
+        }
+    }
+
+    sqeArraySize = params.sq_entries * sizeof(io_uring_sqe);
+    sqeArray = mmap(nullptr, sqeArraySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (sqeArray == MAP_FAILED) {
+        sqeArray = nullptr;
+        release();
+        return;
+    }
+
+    char* sq = static_cast<char*>(sqRing);
+    sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    char* cq = static_cast<char*>(cqRing);
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = cq + params.cq_off.cqes;
+#else
+    (void)entries;
+#endif
+}
+
+IoUring::~IoUring()
+{
+    release();
+}
+
+void IoUring::release()
+{
+#ifdef RAPIDCOMM_HAVE_IO_URING
+    if (sqeArray) munmap(sqeArray, sqeArraySize);
+    if (cqRing && cqRing != sqRing) munmap(cqRing, cqRingSize);
+    if (sqRing) munmap(sqRing, sqRingSize);
+    if (ringFd >= 0) close(ringFd);
+#endif
+    sqeArray = cqRing = sqRing = nullptr;
+    ringFd = -1;
+}
+
+// ----------------------------- Capabilities --------------------------------->
+
+bool IoUring::isSupported()
+{
+    // Kernels can have io_uring compiled out or disabled by sysctl/seccomp
+    static const bool supported = IoUring(2).isReady();
+    return supported;
+}
+
+bool IoUring::isReady() const
+{
+    return ringFd >= 0;
+}
+
+bool IoUring::registerBuffers(const std::vector<iovec>& buffers)
+{
+#ifdef RAPIDCOMM_HAVE_IO_URING
+    if (ringFd < 0) return false;
+    return syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS,
+                   buffers.data(), static_cast<unsigned>(buffers.size())) == 0;
+#else
+    (void)buffers;
+    return false;
+#endif
+}
+
+// ----------------------------- Submission --------------------------------->
+
+void* IoUring::nextSubmission()
+{
+#ifdef RAPIDCOMM_HAVE_IO_URING
+    if (ringFd < 0) return nullptr;
+
+    unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    unsigned tail = *sqTail;
+    if (tail - head >= sqEntries) {
+        return nullptr;
+    }
+
+    unsigned index = tail & *sqMask;
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(sqeArray) + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray[index] = index;
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    pendingSubmissions++;
+    return sqe;
+#else
+    return nullptr;
+#endif
+}
+
+bool IoUring::prepareRecv(int fd, void* buffer, size_t length, int flags, uint64_t tag, bool linkNext)
+{
+#ifdef RAPIDCOMM_HAVE_IO_URING
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(nextSubmission());
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = static_cast<uint32_t>(length);
+    sqe->msg_flags = static_cast<uint32_t>(flags);
+    sqe->user_data = tag;
+    sqe->flags = linkNext ? IOSQE_IO_LINK : 0;
+    return true;
+#else
+    (void)fd; (void)buffer; (void)length; (void)flags; (void)tag; (void)linkNext;
+    return false;
+#endif
+}
+
+bool IoUring::prepareWriteFixed(int fd, const void* buffer, size_t length, off_t offset,
+                                int bufferIndex, uint64_t tag, bool linkNext)
+{
+#ifdef RAPIDCOMM_HAVE_IO_URING
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(nextSubmission());
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = static_cast<uint32_t>(length);
+    sqe->off = static_cast<uint64_t>(offset);
+    sqe->buf_index = static_cast<uint16_t>(bufferIndex);
+    sqe->user_data = tag;
+    sqe->flags = linkNext ? IOSQE_IO_LINK : 0;
+    return true;
+#else
+    (void)fd; (void)buffer; (void)length; (void)offset; (void)bufferIndex; (void)tag; (void)linkNext;
+    return false;
+#endif
+}
+
+bool IoUring::prepareLinkTimeout(int seconds, uint64_t tag, bool linkNext)
+{
+#ifdef RAPIDCOMM_HAVE_IO_URING
+    unsigned slot = *sqTail & *sqMask;
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(nextSubmission());
+    if (!sqe) return false;
+
+    // Laid out as __kernel_timespec { tv_sec, tv_nsec }
+    int64_t* timeout = &timeouts[slot * 2];
+    timeout[0] = seconds;
+    timeout[1] = 0;
+
+    sqe->opcode = IORING_OP_LINK_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast<uint64_t>(timeout);
+    sqe->len = 1;
+    sqe->user_data = tag;
+    sqe->flags = linkNext ? IOSQE_IO_LINK : 0;
+    return true;
+#else
+    (void)seconds; (void)tag; (void)linkNext;
+    return false;
+#endif
+}
+
+int IoUring::submitAndWait(unsigned waitCount)
+{
+#ifdef RAPIDCOMM_HAVE_IO_URING
+    if (ringFd < 0) return -ENODEV;
+
+    // A wait cut short by a signal still reports what was submitted, so
+    // callers reap until they have every completion they expect
+    while (true) {
+        long ret = syscall(__NR_io_uring_enter, ringFd, pendingSubmissions, waitCount, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (ret >= 0) {
+            pendingSubmissions -= std::min<unsigned>(pendingSubmissions, static_cast<unsigned>(ret));
+            return static_cast<int>(ret);
+        }
+        if (errno != EINTR) {
+            return -errno;
+        }
+    }
+#else
+    (void)waitCount;
+    return -ENOSYS;
+#endif
+}
+
+bool IoUring::popCompletion(uint64_t& tag, int& result)
+{
+#ifdef RAPIDCOMM_HAVE_IO_URING
+    if (ringFd < 0) return false;
+
+    unsigned head = *cqHead;
+    if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+
+    const io_uring_cqe& cqe = static_cast<const io_uring_cqe*>(cqes)[head & *cqMask];
+    tag = cqe.user_data;
+    result = cqe.res;
+    __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+    return true;
+#else
+    (void)tag; (void)result;
+    return false;
+#endif
+}
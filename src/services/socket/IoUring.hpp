@@ -0,0 +1,75 @@
+#ifndef IO_URING_HPP
+#define IO_URING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define RAPIDCOMM_HAVE_IO_URING 1
+#endif
+#endif
+
+// Minimal io_uring ring driven through the raw syscalls, so no liburing is
+// needed. Only the handful of operations the upload path uses are exposed.
+// On platforms without io_uring every call fails and callers fall back to
+// plain read/write.
+class IoUring
+{
+public:
+    explicit IoUring(unsigned entries);
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // True when the kernel lets this process create a ring
+    static bool isSupported();
+    bool isReady() const;
+
+    // Buffers pinned once so fixed writes skip the per-call page mapping
+    bool registerBuffers(const std::vector<iovec>& buffers);
+
+    // Each prepare* queues one SQE; linkNext chains it to the following SQE
+    bool prepareRecv(int fd, void* buffer, size_t length, int flags, uint64_t tag, bool linkNext);
+    bool prepareWriteFixed(int fd, const void* buffer, size_t length, off_t offset,
+                           int bufferIndex, uint64_t tag, bool linkNext);
+    // Cancels the SQE queued just before it if it has not completed in time
+    bool prepareLinkTimeout(int seconds, uint64_t tag, bool linkNext);
+
+    // Submits everything queued and blocks for waitCount completions
+    int submitAndWait(unsigned waitCount);
+    bool popCompletion(uint64_t& tag, int& result);
+
+private:
+    int ringFd;
+    unsigned sqEntries;
+    unsigned pendingSubmissions;
+
+    void* sqRing;
+    size_t sqRingSize;
+    void* cqRing;
+    size_t cqRingSize;
+    void* sqeArray;
+    size_t sqeArraySize;
+
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned* sqMask;
+    unsigned* sqArray;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned* cqMask;
+    void* cqes;
+
+    // Timespecs must outlive submission, so each SQE slot owns one
+    std::vector<int64_t> timeouts;
+
+    void* nextSubmission();
+    void release();
+};
+
+#endif // IO_URING_HPP
@@ -1,13 +1,15 @@
 #include "Socket.hpp"
 #include <iostream>
+#include <cerrno>
 
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <fcntl.h>
 
 // ---------------------------------- Constructor ----------------------------------->
 
-Socket::Socket(int port) : port(port)
+Socket::Socket(int port, bool reusePort) : port(port)
 {
     // Creating a socket
     serverSocket = socket(AF_INET, SOCK_STREAM, 0);
@@ -25,6 +27,16 @@ Socket::Socket(int port) : port(port)
         exit(1);
     }
 
+#ifdef SO_REUSEPORT
+    // Let the kernel load-balance incoming connections across sharded listeners
+    if (reusePort && setsockopt(serverSocket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        std::cerr << "Failed to set SO_REUSEPORT!" << std::endl;
+        exit(1);
+    }
+#else
+    (void)reusePort;
+#endif
+
     // Setup server address information
     serverAddress.sin_family = AF_INET;
     serverAddress.sin_addr.s_addr = INADDR_ANY;
@@ -40,7 +52,7 @@ int Socket::getServerSocket()
 
 // ---------------------------------- Start listening ----------------------------------->
 
-void Socket::listenSocket()
+void Socket::listenSocket(int backlog)
 {
     if (bind(serverSocket, (sockaddr *)&serverAddress, sizeof(serverAddress)) == -1)
     {
@@ -49,7 +61,7 @@ void Socket::listenSocket()
         exit(1);
     }
 
-    if (listen(serverSocket, 3) == -1)
+    if (listen(serverSocket, backlog) == -1)
     {
         std::cerr << "Listen failed!" << std::endl;
         closeSocket();
@@ -57,6 +69,68 @@ void Socket::listenSocket()
     }
 }
 
+// ---------------------------------- Non-blocking mode ----------------------------------->
+
+bool Socket::setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1) {
+        return false;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+bool Socket::setBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1) {
+        return false;
+    }
+    return fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) != -1;
+}
+
+void Socket::setNonBlocking()
+{
+    if (!setNonBlocking(serverSocket))
+    {
+        std::cerr << "Failed to set non-blocking mode!" << std::endl;
+        closeSocket();
+        exit(1);
+    }
+}
+
+size_t Socket::acceptBatch(int* clients, size_t maxClients)
+{
+    size_t accepted = 0;
+    while (accepted < maxClients) {
+#ifdef __linux__
+        int clientSocket = accept4(serverSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+        int clientSocket = accept(serverSocket, nullptr, nullptr);
+        if (clientSocket != -1 && !setNonBlocking(clientSocket)) {
+            close(clientSocket);
+            continue;
+        }
+#endif
+        if (clientSocket == -1) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        clients[accepted++] = clientSocket;
+    }
+    return accepted;
+}
+
+bool Socket::supportsReusePort()
+{
+    // Only Linux balances connections across SO_REUSEPORT listeners
+#if defined(__linux__) && defined(SO_REUSEPORT)
+    return true;
+#else
+    return false;
+#endif
+}
+
 // ---------------------------------- Stop listening ----------------------------------->
 
 void Socket::closeSocket()
@@ -2,18 +2,34 @@
 #define SOCKET_HPP
 
 #include <netinet/in.h>
+#include <cstddef>
 
 class Socket
 {
 public:
-    Socket(int port);
+    static const int DEFAULT_BACKLOG = 128;
+
+    // reusePort lets several sockets share one port (one per acceptor shard)
+    Socket(int port, bool reusePort = false);
     ~Socket();
 
     int getServerSocket();
 
-    void listenSocket();
+    void listenSocket(int backlog = DEFAULT_BACKLOG);
     void closeSocket();
 
+    static bool supportsReusePort();
+
+    // Non-blocking mode for use with the EventLoop
+    void setNonBlocking();
+    static bool setNonBlocking(int fd);
+    // Blocking mode while a worker owns a client socket outright
+    static bool setBlocking(int fd);
+
+    // Accepts up to maxClients non-blocking sockets; a short count means the
+    // queue is drained (errno == EAGAIN) or an error occurred
+    size_t acceptBatch(int* clients, size_t maxClients);
+
 private:
     int serverSocket;
     sockaddr_in serverAddress;
@@ -0,0 +1,358 @@
+#include "ContentStore.hpp"
+#include "UploadWriter.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+static const char SHA256_FORMAT[] = "sha256";
+static const char MERKLE_FORMAT[] = "merkle-sha256:";
+static const size_t MERKLE_FORMAT_LENGTH = sizeof(MERKLE_FORMAT) - 1;
+static const size_t DIGEST_HEX_LENGTH = 64;
+static const size_t SHARD_LENGTH = 2;
+static const char REMOVED_MARK[] = "-";         // In place of an object: the name refers to none
+static const size_t COMPACT_MIN_RECORDS = 1024; // Journal lines before a rewrite is worth it
+
+// Which object each file refers to, and how many files refer to each object
+struct ContentIndex
+{
+    bool loaded = false;
+    int journalFd = -1;
+    size_t records = 0; // Lines in the journal, superseded ones included
+    std::unordered_map<std::string, std::string> objects;
+    std::unordered_map<std::string, size_t> references;
+};
+
+// One lock for every store: publishing is a few links and renames, so
+// uploads only queue here for the moment it takes to swap names
+static std::mutex& getIndexMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+static bool writeAll(int fd, const char* data, size_t length)
+{
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+static bool isIndexable(const std::string& filename)
+{
+    return !filename.empty() && filename.find_first_of("\r\n") == std::string::npos;
+}
+
+// ----------------------------- Constructor --------------------------------->
+
+ContentStore::ContentStore(const std::string& storageDirectory, bool durable)
+    : storageDirectory(storageDirectory),
+      objectsDirectory(storageDirectory + ".objects/"),
+      durable(durable)
+{
+}
+
+// ----------------------------- Publishing --------------------------------->
+
+bool ContentStore::isAddressable(const std::string& hash)
+{
+    size_t colon = hash.rfind(':');
+    if (colon == std::string::npos || hash.size() - colon - 1 != DIGEST_HEX_LENGTH ||
+        hash.find_first_not_of("0123456789abcdef", colon + 1) != std::string::npos) {
+        return false;
+    }
+
+    std::string format = hash.substr(0, colon);
+    if (format == SHA256_FORMAT) {
+        return true;
+    }
+    return format.size() > MERKLE_FORMAT_LENGTH && format.compare(0, MERKLE_FORMAT_LENGTH, MERKLE_FORMAT) == 0 &&
+           format.find_first_not_of("0123456789", MERKLE_FORMAT_LENGTH) == std::string::npos;
+}
+
+bool ContentStore::contains(const std::string& hash, size_t size)
+{
+    if (!isAddressable(hash)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(getIndexMutex());
+    getIndex();
+    struct stat info;
+    return stat(getObjectPath(getObjectName(hash)).c_str(), &info) == 0 && static_cast<size_t>(info.st_size) == size;
+}
+
+bool ContentStore::linkExisting(const std::string& hash, size_t size, const std::string& filename, bool replace)
+{
+    if (!isAddressable(hash) || !isIndexable(filename)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(getIndexMutex());
+    ContentIndex& index = getIndex();
+    std::string objectName = getObjectName(hash);
+    std::string objectPath = getObjectPath(objectName);
+    struct stat info;
+    if (stat(objectPath.c_str(), &info) != 0 || static_cast<size_t>(info.st_size) != size) {
+        return false;
+    }
+
+    if (!share(objectPath, storageDirectory + filename, replace)) {
+        return false;
+    }
+    setReference(index, filename, objectName);
+    return true;
+}
+
+std::unique_lock<std::mutex> ContentStore::lockIndex()
+{
+    return std::unique_lock<std::mutex>(getIndexMutex());
+}
+
+bool ContentStore::adopt(const std::string& sourcePath, const std::string& filename, const std::string& hash)
+{
+    ContentIndex& index = getIndex();
+    if (!isAddressable(hash) || !isIndexable(filename)) {
+        // A plain file, which replaced whatever the name referred to
+        setReference(index, filename, "");
+        return true;
+    }
+
+    std::string objectName = getObjectName(hash);
+    std::string objectPath = getObjectPath(objectName);
+    std::string finalPath = storageDirectory + filename;
+    std::error_code error;
+    bool shared;
+    if (std::filesystem::exists(objectPath, error)) {
+        // Seen before: the new copy gives way to the stored one
+        shared = share(objectPath, finalPath, true);
+    } else {
+        std::filesystem::create_directories(std::filesystem::path(objectPath).parent_path(), error);
+        // From the upload's own inode: the name is only ours while the lock is held
+        shared = share(sourcePath, objectPath, true);
+    }
+    // Either way the name no longer refers to what it did
+    setReference(index, filename, shared ? objectName : "");
+    return shared;
+}
+
+void ContentStore::release(const std::string& filename)
+{
+    std::lock_guard<std::mutex> lock(getIndexMutex());
+    setReference(getIndex(), filename, "");
+}
+
+// ----------------------------- Objects --------------------------------->
+
+std::string ContentStore::getObjectName(const std::string& hash) const
+{
+    std::string objectName = hash;
+    for (char& c : objectName) {
+        if (c == ':') {
+            c = '-';
+        }
+    }
+    return objectName;
+}
+
+std::string ContentStore::getObjectPath(const std::string& objectName) const
+{
+    std::string shard = objectName.substr(objectName.size() - DIGEST_HEX_LENGTH, SHARD_LENGTH);
+    return objectsDirectory + shard + "/" + objectName;
+}
+
+bool ContentStore::share(const std::string& sourcePath, const std::string& destinationPath, bool replace) const
+{
+#if defined(__linux__) && defined(O_TMPFILE)
+    // A reflink shares blocks but not the inode, so changing one name in
+    // place never changes another. It is cloned into an anonymous inode,
+    // which only gets a name once it is complete.
+    std::string directory = std::filesystem::path(destinationPath).parent_path().string();
+    int cloneFd = open(directory.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0644);
+    if (cloneFd >= 0) {
+        int sourceFd = open(sourcePath.c_str(), O_RDONLY | O_CLOEXEC);
+        bool cloned = sourceFd >= 0 && ioctl(cloneFd, FICLONE, sourceFd) == 0;
+        if (sourceFd >= 0) {
+            close(sourceFd);
+        }
+        bool shared = cloned && UploadWriter::link("/proc/self/fd/" + std::to_string(cloneFd), destinationPath, replace);
+        int linkError = errno;
+        close(cloneFd);
+        if (cloned) {
+            errno = linkError;
+            return shared;
+        }
+    }
+#endif
+    // A hard link otherwise
+    return UploadWriter::link(sourcePath, destinationPath, replace);
+}
+
+// ----------------------------- Index --------------------------------->
+
+std::string ContentStore::getIndexPath() const
+{
+    return objectsDirectory + "index";
+}
+
+ContentIndex& ContentStore::getIndex()
+{
+    static std::unordered_map<std::string, ContentIndex> indexes;
+    ContentIndex& index = indexes[objectsDirectory];
+    if (index.loaded) {
+        return index;
+    }
+    index.loaded = true;
+
+    // Replayed in order, so the last line for a name wins
+    std::ifstream file(getIndexPath());
+    std::string line;
+    bool rewrite = false;
+    while (std::getline(file, line)) {
+        index.records++;
+        size_t space = line.find(' ');
+        if (file.eof() || space == std::string::npos) {
+            rewrite = true; // Torn by a crash; appending after it would garble the next line
+            continue;
+        }
+        std::string objectName = line.substr(0, space);
+        std::string filename = line.substr(space + 1);
+        if (objectName == REMOVED_MARK) {
+            index.objects.erase(filename);
+        } else {
+            index.objects[filename] = objectName;
+        }
+    }
+
+    // Files deleted behind the server's back no longer count
+    for (auto entry = index.objects.begin(); entry != index.objects.end();) {
+        std::error_code error;
+        if (!std::filesystem::exists(storageDirectory + entry->first, error)) {
+            entry = index.objects.erase(entry);
+            rewrite = true;
+            continue;
+        }
+        index.references[entry->second]++;
+        ++entry;
+    }
+
+    // Objects left behind by a crash between storing and indexing
+    std::error_code error;
+    for (const auto& shard : std::filesystem::directory_iterator(objectsDirectory, error)) {
+        if (!shard.is_directory(error)) {
+            continue;
+        }
+        UploadWriter::removeTemporaryFiles(shard.path().string() + "/");
+        for (const auto& object : std::filesystem::directory_iterator(shard.path(), error)) {
+            if (index.references.find(object.path().filename().string()) == index.references.end()) {
+                std::filesystem::remove(object.path(), error);
+            }
+        }
+    }
+
+    if (rewrite || index.records > index.objects.size()) {
+        compactIndex(index);
+    } else {
+        std::filesystem::create_directories(objectsDirectory, error);
+        index.journalFd = open(getIndexPath().c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    }
+    return index;
+}
+
+void ContentStore::setReference(ContentIndex& index, const std::string& filename, const std::string& objectName)
+{
+    auto previous = index.objects.find(filename);
+    if (previous != index.objects.end()) {
+        if (previous->second == objectName) {
+            return;
+        }
+        if (--index.references[previous->second] == 0) {
+            index.references.erase(previous->second);
+            std::remove(getObjectPath(previous->second).c_str());
+        }
+        index.objects.erase(previous);
+    } else if (objectName.empty()) {
+        return;
+    }
+
+    if (!objectName.empty()) {
+        index.objects[filename] = objectName;
+        index.references[objectName]++;
+    }
+    appendRecord(index, filename, objectName);
+}
+
+bool ContentStore::appendRecord(ContentIndex& index, const std::string& filename, const std::string& objectName)
+{
+    // A rewrite holds this change too, so it replaces the append
+    if (index.journalFd < 0 || (index.records >= COMPACT_MIN_RECORDS && index.records > 2 * index.objects.size())) {
+        return compactIndex(index);
+    }
+
+    // One short O_APPEND write, like a session's .chunks journal
+    std::string line = (objectName.empty() ? REMOVED_MARK : objectName) + " " + filename + "\n";
+    if (write(index.journalFd, line.data(), line.size()) != static_cast<ssize_t>(line.size())) {
+        return compactIndex(index);
+    }
+    index.records++;
+    return true;
+}
+
+bool ContentStore::compactIndex(ContentIndex& index) const
+{
+    std::string contents;
+    for (const auto& entry : index.objects) {
+        contents += entry.second + " " + entry.first + "\n";
+    }
+
+    // Written aside and renamed, so a crash leaves the old journal or the new one
+    std::error_code error;
+    std::filesystem::create_directories(objectsDirectory, error);
+    std::string path = getIndexPath();
+    std::string tempPath = path + ".new";
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool written = writeAll(fd, contents.data(), contents.size()) && (!durable || fsync(fd) == 0);
+    close(fd);
+    if (!written || std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    if (durable) {
+        int directoryFd = open(objectsDirectory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (directoryFd >= 0) {
+            fsync(directoryFd);
+            close(directoryFd);
+        }
+    }
+
+    if (index.journalFd >= 0) {
+        close(index.journalFd);
+    }
+    index.journalFd = open(path.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    index.records = index.objects.size();
+    return true;
+}
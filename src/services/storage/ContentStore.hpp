@@ -0,0 +1,59 @@
+#ifndef CONTENT_STORE_HPP
+#define CONTENT_STORE_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+struct ContentIndex;
+
+// Deduplicated storage. Each distinct content is kept once under .objects/,
+// named by its SHA-256 or tree hash and sharded by the digest's first byte;
+// the files users see are reflinks of those objects where the filesystem
+// supports them and hard links otherwise. .objects/index records which
+// object every file refers to, and an object goes once nothing refers to it.
+// The index is a journal: each change appends one line, and it is rewritten
+// in full only once superseded lines outnumber the live ones.
+class ContentStore
+{
+public:
+    // Durable, a rewritten index is on disk before it replaces the journal
+    explicit ContentStore(const std::string& storageDirectory, bool durable = false);
+
+    // Only "sha256:" and "merkle-sha256:" hashes name content; the legacy hash is too weak
+    static bool isAddressable(const std::string& hash);
+
+    // Whether content with this hash and size is stored
+    bool contains(const std::string& hash, size_t size);
+    // Gives filename the stored content with this hash, if there is any of
+    // that size; without replace an existing filename fails with EEXIST
+    bool linkExisting(const std::string& hash, size_t size, const std::string& filename, bool replace);
+    // Held while a file is named and adopted, so no other upload can take
+    // the name in between and the name and the index change together
+    static std::unique_lock<std::mutex> lockIndex();
+    // Takes in a file just published as filename, read back through the
+    // writer's own sourcePath: its content is stored under hash, or the file
+    // gives way to the copy already stored. Callers hold lockIndex()
+    bool adopt(const std::string& sourcePath, const std::string& filename, const std::string& hash);
+    // Filename no longer refers to stored content (replaced or deleted)
+    void release(const std::string& filename);
+
+    // Appended lines are left for the caller to sync, so they can share a batch
+    std::string getIndexPath() const;
+
+private:
+    std::string storageDirectory;
+    std::string objectsDirectory;
+    bool durable;
+
+    std::string getObjectName(const std::string& hash) const;
+    std::string getObjectPath(const std::string& objectName) const;
+    bool share(const std::string& sourcePath, const std::string& destinationPath, bool replace) const;
+    // Callers hold the index lock
+    ContentIndex& getIndex();
+    void setReference(ContentIndex& index, const std::string& filename, const std::string& objectName);
+    bool appendRecord(ContentIndex& index, const std::string& filename, const std::string& objectName);
+    bool compactIndex(ContentIndex& index) const;
+};
+
+#endif // CONTENT_STORE_HPP
@@ -0,0 +1,444 @@
+#include "FileReceiver.hpp"
+#include "SpscRing.hpp"
+#include "../server/BufferPool.hpp"
+#include "../socket/IoUring.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static const size_t BUFFER_SIZE = BufferPool::MEDIUM;
+static const size_t BUFFER_COUNT = 4;          // recv -> write pairs per submission
+static const int RECEIVE_TIMEOUT_SECONDS = 30; // A stalled client gives up its worker
+static const size_t PIPELINE_DEPTH = 8;            // Buffers in flight between the receiver and the sink
+static const size_t PIPELINE_MIN_LENGTH = 4 * 1024 * 1024;
+
+enum CompletionKind { RECV_DONE = 0, TIMEOUT_DONE = 1, WRITE_DONE = 2 };
+
+static uint64_t makeTag(size_t slot, CompletionKind kind)
+{
+    return (static_cast<uint64_t>(slot) << 2) | kind;
+}
+
+namespace {
+
+// One ring per worker thread. Registered buffers must stay put while the
+// ring lives, so its buffers are taken from the pool once and kept; the
+// ring is declared after them so it is torn down before they go back.
+struct RingContext {
+    std::vector<BufferPool::Buffer> buffers;
+    IoUring ring;
+    bool ready;
+
+    RingContext() : ring(BUFFER_COUNT * 4), ready(false)
+    {
+        if (!ring.isReady()) return;
+
+        std::vector<iovec> registered;
+        for (size_t i = 0; i < BUFFER_COUNT; i++) {
+            BufferPool::Buffer buffer = BufferPool::acquire(BUFFER_SIZE);
+            if (!buffer) return;
+            registered.push_back(iovec{buffer.data(), buffer.size()});
+            buffers.push_back(std::move(buffer));
+        }
+        ready = ring.registerBuffers(registered);
+    }
+};
+
+thread_local std::unique_ptr<RingContext> ringContext;
+
+// The thread the pipeline's consumer stage runs on, started by a worker
+// thread for its first pipelined upload and kept for its lifetime
+class PipelineStage
+{
+public:
+    PipelineStage() : stopping(false), thread(&PipelineStage::run, this) {}
+
+    ~PipelineStage()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        thread.join();
+    }
+
+    void start(std::function<void()> work)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = std::move(work);
+        wake.notify_one();
+    }
+
+    // Returns once the job given to start() has finished
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return !job; });
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::function<void()> job;
+    bool stopping;
+    std::thread thread;
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this]() { return stopping || job; });
+            if (!job) {
+                return;
+            }
+            lock.unlock();
+            job();
+            lock.lock();
+            job = nullptr;
+            done.notify_one();
+        }
+    }
+};
+
+thread_local std::unique_ptr<PipelineStage> pipelineStage;
+
+// A full buffer on its way to the sink; a zero length ends the stream
+struct FilledBuffer {
+    size_t index;
+    size_t length;
+};
+
+} // namespace
+
+// ----------------------------- Constructor --------------------------------->
+
+FileReceiver::FileReceiver(bool useIoUring)
+    : useIoUring(useIoUring && IoUring::isSupported()),
+      pipelined(false)
+{
+}
+
+void FileReceiver::setPipelined(bool enabled)
+{
+    pipelined = enabled;
+}
+
+bool FileReceiver::isPipelined(size_t length) const
+{
+    return pipelined && length >= PIPELINE_MIN_LENGTH;
+}
+
+const char* FileReceiver::backendName(bool useIoUring)
+{
+    return (useIoUring && IoUring::isSupported()) ? "io_uring" : "recv/pwrite";
+}
+
+void FileReceiver::setObserver(Observer observer)
+{
+    this->observer = std::move(observer);
+}
+
+std::string FileReceiver::getLastError() const
+{
+    return lastError;
+}
+
+// ----------------------------- Receive --------------------------------->
+
+bool FileReceiver::receive(int socketFd, int fileFd, off_t offset, size_t length, size_t& bytesWritten)
+{
+    bytesWritten = 0;
+    lastError.clear();
+    if (length == 0) {
+        return true;
+    }
+    if (useIoUring) {
+        return receiveWithIoUring(socketFd, fileFd, offset, length, bytesWritten);
+    }
+    return receiveWithReadWrite(socketFd, fileFd, offset, length, bytesWritten);
+}
+
+bool FileReceiver::receive(int socketFd, size_t length, const Sink& sink)
+{
+    lastError.clear();
+    if (isPipelined(length)) {
+        if (!pipelineStage) {
+            pipelineStage.reset(new PipelineStage());
+        }
+        return receiveWithPipeline(socketFd, length, sink);
+    }
+    setReceiveTimeout(socketFd);
+
+    BufferPool::Buffer buffer = BufferPool::acquire(BUFFER_SIZE);
+    if (!buffer) {
+        lastError = "Out of memory";
+        return false;
+    }
+    size_t received = 0;
+    while (received < length) {
+        ssize_t got = recv(socketFd, buffer.data(), std::min(buffer.size(), length - received), 0);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            setReceiveError(got);
+            return false;
+        }
+        received += static_cast<size_t>(got);
+        if (observer) observer(buffer.data(), static_cast<size_t>(got));
+        if (!sink(buffer.data(), static_cast<size_t>(got))) {
+            lastError = "Rejected by the consumer";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FileReceiver::receiveWithIoUring(int socketFd, int fileFd, off_t offset, size_t length, size_t& bytesWritten)
+{
+    if (!ringContext) {
+        ringContext.reset(new RingContext());
+    }
+    if (!ringContext->ready) {
+        return receiveWithReadWrite(socketFd, fileFd, offset, length, bytesWritten);
+    }
+
+    IoUring& ring = ringContext->ring;
+    const std::vector<BufferPool::Buffer>& buffers = ringContext->buffers;
+
+    while (bytesWritten < length) {
+        // One chain: recv0 -> write0 -> recv1 -> write1 ... so the socket is
+        // read strictly in order and each buffer is on disk before its reuse
+        size_t planned[BUFFER_COUNT];
+        size_t count = 0;
+        size_t queued = 0;
+        while (count < BUFFER_COUNT && bytesWritten + queued < length) {
+            planned[count] = std::min(BUFFER_SIZE, length - bytesWritten - queued);
+            queued += planned[count];
+            count++;
+        }
+
+        off_t at = offset + static_cast<off_t>(bytesWritten);
+        for (size_t i = 0; i < count; i++) {
+            ring.prepareRecv(socketFd, buffers[i].data(), planned[i], MSG_WAITALL, makeTag(i, RECV_DONE), true);
+            ring.prepareLinkTimeout(RECEIVE_TIMEOUT_SECONDS, makeTag(i, TIMEOUT_DONE), true);
+            ring.prepareWriteFixed(fileFd, buffers[i].data(), planned[i], at, static_cast<int>(i),
+                                   makeTag(i, WRITE_DONE), i + 1 < count);
+            at += static_cast<off_t>(planned[i]);
+        }
+
+        int received[BUFFER_COUNT];
+        int written[BUFFER_COUNT];
+        std::fill(received, received + count, -ECANCELED);
+        std::fill(written, written + count, -ECANCELED);
+
+        // Every SQE, cancelled or not, posts exactly one completion
+        size_t expected = count * 3;
+        size_t reaped = 0;
+        int ret = ring.submitAndWait(static_cast<unsigned>(expected));
+        while (ret >= 0 && reaped < expected) {
+            uint64_t tag;
+            int result;
+            if (!ring.popCompletion(tag, result)) {
+                ret = ring.submitAndWait(1);
+                continue;
+            }
+            reaped++;
+            size_t slot = static_cast<size_t>(tag >> 2);
+            if ((tag & 3) == RECV_DONE) received[slot] = result;
+            if ((tag & 3) == WRITE_DONE) written[slot] = result;
+        }
+        if (ret < 0) {
+            // The kernel may still own the buffers; rebuild the ring next time
+            ringContext.reset();
+            lastError = "io_uring wait failed: " + std::string(strerror(-ret));
+            return false;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            if (received[i] <= 0) {
+                lastError = received[i] == 0 ? "Client closed the connection" :
+                            received[i] == -ECANCELED ? "Timed out waiting for the client" :
+                            "Receive failed: " + std::string(strerror(-received[i]));
+                return false;
+            }
+
+            size_t got = static_cast<size_t>(received[i]);
+            size_t done = written[i] > 0 ? static_cast<size_t>(written[i]) : 0;
+            if (done < got) {
+                // A short recv breaks the link, so its write never ran; finish it here
+                off_t position = offset + static_cast<off_t>(bytesWritten + done);
+                if (!writeFully(fileFd, buffers[i].data() + done, got - done, position)) {
+                    return false;
+                }
+            }
+            if (observer) observer(buffers[i].data(), got);
+            bytesWritten += got;
+
+            if (got < planned[i]) {
+                break; // The rest of the chain was cancelled unread
+            }
+        }
+    }
+    return true;
+}
+
+bool FileReceiver::receiveWithReadWrite(int socketFd, int fileFd, off_t offset, size_t length, size_t& bytesWritten)
+{
+    setReceiveTimeout(socketFd);
+
+    BufferPool::Buffer buffer = BufferPool::acquire(BUFFER_SIZE);
+    if (!buffer) {
+        lastError = "Out of memory";
+        return false;
+    }
+    while (bytesWritten < length) {
+        size_t wanted = std::min(buffer.size(), length - bytesWritten);
+        ssize_t got = recv(socketFd, buffer.data(), wanted, 0);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            setReceiveError(got);
+            return false;
+        }
+        if (!writeFully(fileFd, buffer.data(), static_cast<size_t>(got), offset + static_cast<off_t>(bytesWritten))) {
+            return false;
+        }
+        if (observer) observer(buffer.data(), static_cast<size_t>(got));
+        bytesWritten += static_cast<size_t>(got);
+    }
+    return true;
+}
+
+bool FileReceiver::receiveWithPipeline(int socketFd, size_t length, const Sink& sink)
+{
+    // Taken from the pool per upload, so idle workers hold no pipeline memory
+    std::vector<BufferPool::Buffer> pooled;
+    std::vector<char*> buffers;
+    for (size_t i = 0; i < PIPELINE_DEPTH; i++) {
+        pooled.push_back(BufferPool::acquire(BUFFER_SIZE));
+        if (!pooled.back()) {
+            lastError = "Out of memory";
+            return false;
+        }
+        buffers.push_back(pooled.back().data());
+    }
+    setReceiveTimeout(socketFd);
+
+    SpscRing<FilledBuffer> filled(PIPELINE_DEPTH);
+    SpscRing<size_t> empty(PIPELINE_DEPTH);
+    for (size_t i = 0; i < PIPELINE_DEPTH; i++) {
+        empty.tryPush(i);
+    }
+
+    // The consumer stage: everything the observer and the sink do happens here
+    std::atomic<bool> rejected(false);
+    std::string stageError;
+    pipelineStage->start([&]() {
+        FilledBuffer piece;
+        while (true) {
+            filled.pop(piece);
+            if (piece.length == 0) {
+                return;
+            }
+            // After a rejection buffers still come back, so the receiver never waits forever
+            if (!rejected.load(std::memory_order_relaxed)) {
+                try {
+                    if (observer) observer(buffers[piece.index], piece.length);
+                    if (!sink(buffers[piece.index], piece.length)) {
+                        rejected.store(true, std::memory_order_relaxed);
+                    }
+                } catch (const std::exception& e) {
+                    stageError = e.what();
+                    rejected.store(true, std::memory_order_relaxed);
+                } catch (...) {
+                    stageError = "unknown error";
+                    rejected.store(true, std::memory_order_relaxed);
+                }
+            }
+            empty.push(piece.index);
+        }
+    });
+
+    // The receiver stage fills whole buffers, so the sink sees few large pieces
+    size_t received = 0;
+    bool success = true;
+    while (success && received < length && !rejected.load(std::memory_order_relaxed)) {
+        size_t index;
+        empty.pop(index);
+        size_t wanted = std::min(BUFFER_SIZE, length - received);
+        size_t got = 0;
+        while (got < wanted) {
+            ssize_t result = recv(socketFd, buffers[index] + got, wanted - got, 0);
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result <= 0) {
+                setReceiveError(result);
+                success = false;
+                break;
+            }
+            got += static_cast<size_t>(result);
+        }
+        if (got > 0) {
+            filled.push(FilledBuffer{index, got});
+            received += got;
+        }
+    }
+    filled.push(FilledBuffer{0, 0});
+    pipelineStage->wait();
+
+    if (rejected.load(std::memory_order_relaxed)) {
+        lastError = stageError.empty() ? "Rejected by the consumer" : "Consumer failed: " + stageError;
+        return false;
+    }
+    return success;
+}
+
+void FileReceiver::setReceiveTimeout(int socketFd)
+{
+    timeval timeout;
+    timeout.tv_sec = RECEIVE_TIMEOUT_SECONDS;
+    timeout.tv_usec = 0;
+    setsockopt(socketFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+void FileReceiver::setReceiveError(ssize_t result)
+{
+    lastError = result == 0 ? "Client closed the connection" :
+                (errno == EAGAIN || errno == EWOULDBLOCK) ? "Timed out waiting for the client" :
+                "Receive failed: " + std::string(strerror(errno));
+}
+
+bool FileReceiver::writeFully(int fileFd, const char* data, size_t length, off_t offset)
+{
+    while (length > 0) {
+        ssize_t written = pwrite(fileFd, data, length, offset);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            lastError = "Write failed: " + std::string(written < 0 ? strerror(errno) : "no progress");
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+        offset += written;
+    }
+    return true;
+}
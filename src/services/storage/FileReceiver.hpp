@@ -0,0 +1,59 @@
+#ifndef FILE_RECEIVER_HPP
+#define FILE_RECEIVER_HPP
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <sys/types.h>
+
+// Moves an exact number of body bytes from a blocking client socket into a
+// file. With io_uring each buffer becomes a linked recv -> fixed-write pair
+// and a whole batch of pairs costs one syscall; otherwise it falls back to
+// recv + pwrite. Each worker thread keeps its own ring and pinned buffers.
+//
+// Pipelined, a body handed to a sink is received and consumed at the same
+// time: the calling thread fills buffers from the socket while its stage
+// thread (started once per worker thread, like the ring) runs the observer
+// and the sink on the ones already full; whatever they throw rejects the
+// body. Buffers go back and forth through two SpscRings; once the sink
+// falls behind, the receiver runs out of empty buffers and stops reading,
+// so TCP slows the client down instead of memory filling up.
+class FileReceiver
+{
+public:
+    explicit FileReceiver(bool useIoUring);
+
+    // Returns false on a short transfer; bytesWritten says how far it got
+    bool receive(int socketFd, int fileFd, off_t offset, size_t length, size_t& bytesWritten);
+
+    // Hands each received piece to sink instead of a file (sink returns false to stop)
+    using Sink = std::function<bool(const char* data, size_t length)>;
+    bool receive(int socketFd, size_t length, const Sink& sink);
+
+    // Lets receive() with a sink run it, and the observer, on their own thread
+    void setPipelined(bool enabled);
+    // Whether a body of this length would be pipelined; small ones are not worth the handoff
+    bool isPipelined(size_t length) const;
+
+    // Sees every received piece in socket order, before its buffer is reused
+    using Observer = std::function<void(const char* data, size_t length)>;
+    void setObserver(Observer observer);
+
+    std::string getLastError() const;
+    static const char* backendName(bool useIoUring);
+
+private:
+    bool useIoUring;
+    bool pipelined;
+    std::string lastError;
+    Observer observer;
+
+    bool receiveWithIoUring(int socketFd, int fileFd, off_t offset, size_t length, size_t& bytesWritten);
+    bool receiveWithReadWrite(int socketFd, int fileFd, off_t offset, size_t length, size_t& bytesWritten);
+    bool receiveWithPipeline(int socketFd, size_t length, const Sink& sink);
+    bool writeFully(int fileFd, const char* data, size_t length, off_t offset);
+    void setReceiveTimeout(int socketFd);
+    void setReceiveError(ssize_t result);
+};
+
+#endif // FILE_RECEIVER_HPP
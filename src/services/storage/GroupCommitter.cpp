@@ -0,0 +1,115 @@
+#include "GroupCommitter.hpp"
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// ----------------------------- Constructor/Destructor --------------------------------->
+
+GroupCommitter::GroupCommitter()
+    : stopping(false),
+      thread(&GroupCommitter::commitLoop, this)
+{
+}
+
+GroupCommitter::~GroupCommitter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    pending.notify_one();
+    thread.join();
+}
+
+// ----------------------------- Requests --------------------------------->
+
+bool GroupCommitter::syncFile(const std::string& path)
+{
+    return submit(path, false);
+}
+
+bool GroupCommitter::syncDirectory(const std::string& path)
+{
+    return submit(path, true);
+}
+
+bool GroupCommitter::submit(const std::string& path, bool directory)
+{
+    Request request{path, directory, false, false};
+    std::unique_lock<std::mutex> lock(mutex);
+    queue.push_back(&request);
+    pending.notify_one();
+    committed.wait(lock, [&request]() { return request.done; });
+    return request.success;
+}
+
+// ----------------------------- Commit Loop --------------------------------->
+
+void GroupCommitter::commitLoop()
+{
+    std::vector<Request*> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            pending.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            // Whatever queued up during the previous flush goes out together
+            batch.swap(queue);
+        }
+
+        commitBatch(batch);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (Request* request : batch) {
+                request->done = true;
+            }
+        }
+        committed.notify_all();
+        batch.clear();
+    }
+}
+
+void GroupCommitter::commitBatch(const std::vector<Request*>& batch)
+{
+    // One open descriptor per distinct path: a directory shared by the whole
+    // batch is synced once
+    std::unordered_map<std::string, int> descriptors;
+    for (Request* request : batch) {
+        if (descriptors.count(request->path) == 0) {
+            int flags = request->directory ? O_RDONLY | O_DIRECTORY : O_RDONLY;
+            descriptors[request->path] = open(request->path.c_str(), flags | O_CLOEXEC);
+        }
+    }
+
+#ifdef __linux__
+    // Start writeback everywhere first, so the device sees the whole batch
+    // at once rather than one file per flush
+    for (Request* request : batch) {
+        int fd = descriptors[request->path];
+        if (fd >= 0 && !request->directory) {
+            sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+        }
+    }
+#endif
+
+    std::unordered_map<std::string, bool> results;
+    for (Request* request : batch) {
+        auto result = results.find(request->path);
+        if (result == results.end()) {
+            int fd = descriptors[request->path];
+            bool synced = fd >= 0 && (request->directory ? fsync(fd) : fdatasync(fd)) == 0;
+            result = results.emplace(request->path, synced).first;
+        }
+        request->success = result->second;
+    }
+
+    for (const auto& descriptor : descriptors) {
+        if (descriptor.second >= 0) {
+            close(descriptor.second);
+        }
+    }
+}
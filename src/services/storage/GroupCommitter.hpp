@@ -0,0 +1,49 @@
+#ifndef GROUP_COMMITTER_HPP
+#define GROUP_COMMITTER_HPP
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Makes files and directory entries durable in batches. Callers block until
+// the batch holding their request is on disk; one background thread starts
+// writeback for every file in a batch before waiting on any of them and
+// syncs each directory once, so many small uploads share the cost of a few
+// disk flushes instead of paying one each.
+class GroupCommitter
+{
+public:
+    GroupCommitter();
+    ~GroupCommitter();
+
+    GroupCommitter(const GroupCommitter&) = delete;
+    GroupCommitter& operator=(const GroupCommitter&) = delete;
+
+    // The file's data, and the size needed to read it back
+    bool syncFile(const std::string& path);
+    // The names created, renamed or removed in the directory
+    bool syncDirectory(const std::string& path);
+
+private:
+    struct Request {
+        std::string path;
+        bool directory;
+        bool done;
+        bool success;
+    };
+
+    std::mutex mutex;
+    std::condition_variable pending;
+    std::condition_variable committed;
+    std::vector<Request*> queue;
+    bool stopping;
+    std::thread thread;
+
+    bool submit(const std::string& path, bool directory);
+    void commitLoop();
+    static void commitBatch(const std::vector<Request*>& batch);
+};
+
+#endif // GROUP_COMMITTER_HPP
@@ -0,0 +1,164 @@
+#include "IntegrityHasher.hpp"
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+
+static const char SHA256_PREFIX[] = "sha256:";
+static const char MERKLE_PREFIX[] = "merkle-sha256:";
+static const size_t SHA256_PREFIX_LENGTH = sizeof(SHA256_PREFIX) - 1;
+static const size_t MERKLE_PREFIX_LENGTH = sizeof(MERKLE_PREFIX) - 1;
+static const size_t DIGEST_HEX_LENGTH = 2 * Sha256::DIGEST_SIZE; // The legacy hash is padded to the same length
+static const size_t MIN_TREE_LEAVES = 4; // Fewer leaves than this are not worth spreading out
+
+IntegrityHasher::IntegrityHasher(Algorithm algorithm, size_t leafSize)
+    : algorithm(algorithm),
+      finished(false)
+{
+    if (algorithm == Algorithm::Merkle) {
+        tree.reset(new MerkleHasher(leafSize));
+    }
+}
+
+// The leaf size of a "merkle-sha256:<leafSize>:<hex>" hash, 0 if it has none
+static size_t parseLeafSize(std::string_view originalHash)
+{
+    std::string declared(originalHash.substr(MERKLE_PREFIX_LENGTH));
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long size = strtoull(declared.c_str(), &end, 10);
+    if (errno != 0 || end == declared.c_str() || *end != ':') {
+        return 0;
+    }
+    return static_cast<size_t>(size);
+}
+
+IntegrityHasher::Algorithm IntegrityHasher::negotiate(std::string_view originalHash, size_t expectedSize, size_t& leafSize)
+{
+    if (originalHash.compare(0, MERKLE_PREFIX_LENGTH, MERKLE_PREFIX) == 0) {
+        // The client's leaf size wins, or its root could never match
+        if (checkDeclared(originalHash).empty()) {
+            leafSize = parseLeafSize(originalHash);
+        }
+        return Algorithm::Merkle;
+    }
+    if (originalHash.compare(0, SHA256_PREFIX_LENGTH, SHA256_PREFIX) == 0) {
+        return Algorithm::Sha256;
+    }
+    if (!originalHash.empty()) {
+        return Algorithm::Legacy;
+    }
+    bool spansLeaves = leafSize > 0 && expectedSize / leafSize >= MIN_TREE_LEAVES;
+    return spansLeaves && MerkleHasher::isParallel() ? Algorithm::Merkle : Algorithm::Sha256;
+}
+
+std::string IntegrityHasher::checkDeclared(std::string_view originalHash)
+{
+    if (originalHash.empty()) {
+        return "";
+    }
+
+    // Every form ends in a full digest; legacy hashes are nothing else
+    std::string_view digest = originalHash;
+    if (originalHash.compare(0, MERKLE_PREFIX_LENGTH, MERKLE_PREFIX) == 0) {
+        size_t leafSize = parseLeafSize(originalHash);
+        if (leafSize < MerkleHasher::MIN_LEAF_SIZE || leafSize > MerkleHasher::MAX_LEAF_SIZE) {
+            return "Invalid hash: merkle-sha256 leaf size must be " + std::to_string(MerkleHasher::MIN_LEAF_SIZE) +
+                   " to " + std::to_string(MerkleHasher::MAX_LEAF_SIZE) + " bytes";
+        }
+        digest = originalHash.substr(originalHash.find(':', MERKLE_PREFIX_LENGTH) + 1);
+    } else if (originalHash.compare(0, SHA256_PREFIX_LENGTH, SHA256_PREFIX) == 0) {
+        digest = originalHash.substr(SHA256_PREFIX_LENGTH);
+    }
+    if (digest.size() != DIGEST_HEX_LENGTH || digest.find_first_not_of("0123456789abcdefABCDEF") != std::string_view::npos) {
+        return "Unsupported hash format: expected sha256:<hex>, merkle-sha256:<leafSize>:<hex> or a legacy hash";
+    }
+    return "";
+}
+
+const char* IntegrityHasher::algorithmName(Algorithm algorithm)
+{
+    return algorithm == Algorithm::Merkle ? "merkle-sha256" :
+           algorithm == Algorithm::Sha256 ? "sha256" : "legacy";
+}
+
+void IntegrityHasher::update(const char* data, size_t length)
+{
+    if (algorithm == Algorithm::Merkle) {
+        tree->update(data, length);
+    } else if (algorithm == Algorithm::Sha256) {
+        sha256.update(data, length);
+    } else {
+        legacy.update(data, length);
+    }
+}
+
+std::string IntegrityHasher::finish()
+{
+    if (finished) {
+        return digest;
+    }
+    finished = true;
+
+    if (algorithm == Algorithm::Merkle) {
+        digest = formatTree(tree->finish(), tree->getLeafSize());
+    } else if (algorithm == Algorithm::Sha256) {
+        digest = SHA256_PREFIX + sha256.hexDigest();
+    } else {
+        digest = legacy.finish();
+    }
+    return digest;
+}
+
+std::string IntegrityHasher::formatTree(const MerkleHasher::Digest& root, size_t leafSize)
+{
+    return MERKLE_PREFIX + std::to_string(leafSize) + ":" + Sha256::toHex(root.data(), root.size());
+}
+
+IntegrityHasher::Algorithm IntegrityHasher::getAlgorithm() const
+{
+    return algorithm;
+}
+
+const MerkleHasher* IntegrityHasher::getTree() const
+{
+    return tree.get();
+}
+
+// ----------------------------- Verification --------------------------------->
+
+void IntegrityHasher::expect(std::string_view originalHash)
+{
+    expected = std::string(originalHash);
+}
+
+IntegrityHasher::Verdict IntegrityHasher::verify()
+{
+    return expected.empty() ? Verdict::Unchecked : compare(expected, finish());
+}
+
+IntegrityHasher::Verdict IntegrityHasher::compare(std::string_view expected, std::string_view actual)
+{
+    if (expected.empty()) {
+        return Verdict::Unchecked;
+    }
+
+    // A hash the client computed another way (or over other leaves) cannot
+    // vouch for this digest, so it fails rather than passing unchecked.
+    // The format is everything up to the last ':' (none for legacy, as npos + 1 == 0)
+    size_t expectedFormat = expected.rfind(':');
+    size_t actualFormat = actual.rfind(':');
+    if (expected.substr(0, expectedFormat + 1) != actual.substr(0, actualFormat + 1) || expected.size() != actual.size()) {
+        return Verdict::Mismatch;
+    }
+    for (size_t i = 0; i < actual.size(); i++) {
+        if (tolower(static_cast<unsigned char>(expected[i])) != actual[i]) {
+            return Verdict::Mismatch;
+        }
+    }
+    return Verdict::Match;
+}
+
+const std::string& IntegrityHasher::getExpected() const
+{
+    return expected;
+}
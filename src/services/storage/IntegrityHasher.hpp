@@ -0,0 +1,60 @@
+#ifndef INTEGRITY_HASHER_HPP
+#define INTEGRITY_HASHER_HPP
+
+#include "LegacyHasher.hpp"
+#include "MerkleHasher.hpp"
+#include "Sha256.hpp"
+#include <memory>
+#include <string>
+#include <string_view>
+
+// The hash reported back for an upload. SHA-256 digests are written as
+// "sha256:<hex>", hash tree roots as "merkle-sha256:<leafSize>:<hex>"; the
+// legacy hash keeps its old unprefixed form, so a client can tell from its
+// own originalHash which one the server will answer with.
+class IntegrityHasher
+{
+public:
+    enum class Algorithm { Legacy, Sha256, Merkle };
+    // Unchecked: nothing was declared. A declared hash of another format
+    // than the digest is a mismatch, since it proves nothing about the data
+    enum class Verdict { Unchecked, Match, Mismatch };
+
+    explicit IntegrityHasher(Algorithm algorithm = Algorithm::Sha256, size_t leafSize = 0);
+
+    // Picks the algorithm the client's originalHash was computed with, and
+    // for a tree its leaf size. Clients that send none get a tree when the
+    // upload spans several leaves and there are cores to hash them on,
+    // plain SHA-256 otherwise.
+    static Algorithm negotiate(std::string_view originalHash, size_t expectedSize, size_t& leafSize);
+    // Why a declared hash can never be checked (an unknown format, a
+    // malformed digest, a tree leaf size out of range), empty if it can;
+    // such uploads are refused, not left unchecked
+    static std::string checkDeclared(std::string_view originalHash);
+    static const char* algorithmName(Algorithm algorithm);
+
+    void update(const char* data, size_t length);
+    // Hex digest of everything fed so far; no more data may follow
+    std::string finish();
+    Algorithm getAlgorithm() const;
+    static std::string formatTree(const MerkleHasher::Digest& root, size_t leafSize);
+
+    // The client's originalHash, compared with the digest by verify()
+    void expect(std::string_view originalHash);
+    Verdict verify();
+    static Verdict compare(std::string_view expected, std::string_view actual);
+    const std::string& getExpected() const;
+    // Leaf digests of a tree hash, for checking single chunks later
+    const MerkleHasher* getTree() const;
+
+private:
+    Algorithm algorithm;
+    LegacyHasher legacy;
+    Sha256 sha256;
+    std::unique_ptr<MerkleHasher> tree;
+    std::string expected;
+    std::string digest;
+    bool finished;
+};
+
+#endif // INTEGRITY_HASHER_HPP
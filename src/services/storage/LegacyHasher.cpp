@@ -0,0 +1,78 @@
+#include "LegacyHasher.hpp"
+#include <sstream>
+
+// Powers of the multiplier, so four bytes fold into the hash with one
+// dependent multiply instead of four
+static const uint32_t M1 = 31;
+static const uint32_t M2 = M1 * M1;
+static const uint32_t M3 = M2 * M1;
+static const uint32_t M4 = M3 * M1;
+
+static inline uint32_t rotateLeft(uint32_t value)
+{
+    return (value << 1) | (value >> 31);
+}
+
+static inline uint32_t foldString(uint32_t hash, const std::string& text)
+{
+    for (char c : text) {
+        hash = hash * M1 + static_cast<unsigned char>(c);
+    }
+    return hash;
+}
+
+// ----------------------------- LegacyHasher --------------------------------->
+
+LegacyHasher::LegacyHasher()
+    : hash(0), checksum(0), size(0)
+{
+}
+
+void LegacyHasher::update(const char* data, size_t length)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    uint32_t h = hash;
+    uint32_t c = checksum;
+
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4) {
+        uint32_t b0 = bytes[i];
+        uint32_t b1 = bytes[i + 1];
+        uint32_t b2 = bytes[i + 2];
+        uint32_t b3 = bytes[i + 3];
+
+        h = h * M4 + b0 * M3 + b1 * M2 + b2 * M1 + b3;
+
+        c = rotateLeft(c + b0);
+        c = rotateLeft(c + b1);
+        c = rotateLeft(c + b2);
+        c = rotateLeft(c + b3);
+    }
+    for (; i < length; i++) {
+        h = h * M1 + bytes[i];
+        c = rotateLeft(c + bytes[i]);
+    }
+
+    hash = h;
+    checksum = c;
+    size += length;
+}
+
+std::string LegacyHasher::finish() const
+{
+    // The salted hashes continue from the plain one, which already covers the data
+    uint32_t salted1 = foldString(hash, "salt1");
+    uint32_t salted2 = foldString(hash, "salt2" + std::to_string(size));
+
+    std::ostringstream oss;
+    oss << std::hex << hash << salted1 << salted2 << checksum;
+
+    std::string result = oss.str();
+    result.resize(64, '0');
+    return result;
+}
+
+size_t LegacyHasher::getSize() const
+{
+    return size;
+}
@@ -0,0 +1,30 @@
+#ifndef LEGACY_HASHER_HPP
+#define LEGACY_HASHER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// The integrity hash the server has always reported: three 31-multiplier
+// rolling hashes over the data (two of them finished with a salt) plus a
+// rotating checksum, printed as hex and padded to 64 characters. All three
+// hashes share the same pass over the data, so one fused loop computes them
+// together with the checksum. Data can be fed in any number of pieces.
+class LegacyHasher
+{
+public:
+    LegacyHasher();
+
+    void update(const char* data, size_t length);
+    // Hex digest of everything fed so far; the hasher can keep going after
+    std::string finish() const;
+
+    size_t getSize() const;
+
+private:
+    uint32_t hash;
+    uint32_t checksum;
+    size_t size;
+};
+
+#endif // LEGACY_HASHER_HPP
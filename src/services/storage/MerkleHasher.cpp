@@ -0,0 +1,200 @@
+#include "MerkleHasher.hpp"
+#include "../server/WorkerPool.hpp"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <utility>
+
+static const uint8_t LEAF_TAG = 0x00;
+static const uint8_t NODE_TAG = 0x01;
+static const size_t LEAVES_PER_THREAD = 2; // Copied leaves allowed to wait per pool thread
+
+// Separate from the request pool: a request waiting on its own leaves must
+// never be queued behind them
+static WorkerPool& getHashPool()
+{
+    static WorkerPool pool;
+    return pool;
+}
+
+static MerkleHasher::Digest digestOf(const Sha256& hasher)
+{
+    MerkleHasher::Digest digest;
+    hasher.digest(digest.data());
+    return digest;
+}
+
+// ----------------------------- Constructor/Destructor --------------------------------->
+
+MerkleHasher::MerkleHasher(size_t leafSize)
+    : leafSize(leafSize),
+      parallel(isParallel() && leafSize <= PARALLEL_MEMORY / 2),
+      inFlightLimit(0),
+      finished(false),
+      openSize(0),
+      inFlight(0)
+{
+    if (parallel) {
+        // The open leaf and every one in flight or spare each own a buffer
+        inFlightLimit = std::min(getHashPool().size() * LEAVES_PER_THREAD, PARALLEL_MEMORY / leafSize - 1);
+    }
+}
+
+MerkleHasher::~MerkleHasher()
+{
+    // Pool tasks point back at this object
+    waitForLeaves(0);
+}
+
+// ----------------------------- Hashing --------------------------------->
+
+void MerkleHasher::update(const char* data, size_t length)
+{
+    while (length > 0) {
+        if (openSize == 0) {
+            if (parallel) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!spareBuffers.empty()) {
+                    openBuffer = std::move(spareBuffers.back());
+                    spareBuffers.pop_back();
+                }
+            } else {
+                openLeaf = leafHasher();
+            }
+            if (parallel && !openBuffer) {
+                openBuffer.reset(new std::vector<char>(leafSize));
+            }
+        }
+
+        size_t take = std::min(length, leafSize - openSize);
+        if (parallel) {
+            memcpy(openBuffer->data() + openSize, data, take);
+        } else {
+            openLeaf.update(data, take);
+        }
+        openSize += take;
+        data += take;
+        length -= take;
+
+        if (openSize == leafSize) {
+            closeLeaf();
+        }
+    }
+}
+
+MerkleHasher::Digest MerkleHasher::finish()
+{
+    if (!finished) {
+        if (openSize > 0) {
+            closeLeaf();
+        }
+        waitForLeaves(0);
+        if (leaves.empty()) {
+            leaves.push_back(hashLeaf(nullptr, 0));
+        }
+        finished = true;
+    }
+    return combine(leaves);
+}
+
+void MerkleHasher::closeLeaf()
+{
+    size_t index;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        index = leaves.size();
+        leaves.emplace_back();
+    }
+
+    if (parallel) {
+        submitLeaf(index, std::move(openBuffer), openSize);
+    } else {
+        leaves[index] = digestOf(openLeaf);
+    }
+    openSize = 0;
+}
+
+void MerkleHasher::submitLeaf(size_t index, LeafBuffer buffer, size_t length)
+{
+    // Bounded so a fast sender cannot pile up copied leaves in memory
+    waitForLeaves(inFlightLimit - 1);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inFlight++;
+    }
+
+    std::vector<char>* leaf = buffer.release();
+    getHashPool().submit([this, index, leaf, length]() {
+        Digest digest = hashLeaf(leaf->data(), length);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            leaves[index] = digest;
+            spareBuffers.emplace_back(leaf);
+            inFlight--;
+        }
+        leafDone.notify_all();
+    });
+}
+
+void MerkleHasher::waitForLeaves(size_t limit)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    leafDone.wait(lock, [this, limit]() { return inFlight <= limit; });
+}
+
+// ----------------------------- Tree --------------------------------->
+
+MerkleHasher::Digest MerkleHasher::hashLeaf(const char* data, size_t length)
+{
+    Sha256 hasher = leafHasher();
+    hasher.update(data, length);
+    return digestOf(hasher);
+}
+
+Sha256 MerkleHasher::leafHasher()
+{
+    Sha256 hasher;
+    hasher.update(reinterpret_cast<const char*>(&LEAF_TAG), 1);
+    return hasher;
+}
+
+MerkleHasher::Digest MerkleHasher::combine(std::vector<Digest> level)
+{
+    if (level.empty()) {
+        return hashLeaf(nullptr, 0);
+    }
+
+    while (level.size() > 1) {
+        size_t parents = 0;
+        for (size_t i = 0; i < level.size(); i += 2) {
+            if (i + 1 == level.size()) {
+                level[parents++] = level[i];
+                break;
+            }
+            Sha256 hasher;
+            hasher.update(reinterpret_cast<const char*>(&NODE_TAG), 1);
+            hasher.update(reinterpret_cast<const char*>(level[i].data()), level[i].size());
+            hasher.update(reinterpret_cast<const char*>(level[i + 1].data()), level[i + 1].size());
+            level[parents++] = digestOf(hasher);
+        }
+        level.resize(parents);
+    }
+    return level[0];
+}
+
+bool MerkleHasher::isParallel()
+{
+    return std::thread::hardware_concurrency() > 1;
+}
+
+// ----------------------------- Accessors --------------------------------->
+
+size_t MerkleHasher::getLeafSize() const
+{
+    return leafSize;
+}
+
+const std::vector<MerkleHasher::Digest>& MerkleHasher::getLeaves() const
+{
+    return leaves;
+}
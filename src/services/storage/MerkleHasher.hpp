@@ -0,0 +1,76 @@
+#ifndef MERKLE_HASHER_HPP
+#define MERKLE_HASHER_HPP
+
+#include "Sha256.hpp"
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// SHA-256 hash tree over fixed-size leaves. Leaf digests are
+// SHA-256(0x00 || leaf), parents are SHA-256(0x01 || left || right), and an
+// unpaired node moves up a level unchanged. Full leaves are hashed on a
+// shared pool while the caller keeps feeding data, so big files hash on
+// every core; the leaf digests stay available to check single chunks later.
+// Leaves copied out for the pool never take more than PARALLEL_MEMORY, and
+// leaves too big to keep two of them in it are hashed inline.
+class MerkleHasher
+{
+public:
+    using Digest = std::array<uint8_t, Sha256::DIGEST_SIZE>;
+
+    static const size_t MIN_LEAF_SIZE = 4 * 1024;
+    static const size_t MAX_LEAF_SIZE = 64 * 1024 * 1024;
+    static const size_t PARALLEL_MEMORY = 4 * 1024 * 1024; // Leaf copies one hasher may hold
+
+    explicit MerkleHasher(size_t leafSize);
+    ~MerkleHasher();
+
+    MerkleHasher(const MerkleHasher&) = delete;
+    MerkleHasher& operator=(const MerkleHasher&) = delete;
+
+    void update(const char* data, size_t length);
+    // Root of everything fed so far; no more data may follow
+    Digest finish();
+
+    size_t getLeafSize() const;
+    // Valid after finish()
+    const std::vector<Digest>& getLeaves() const;
+
+    static Digest hashLeaf(const char* data, size_t length);
+    // For a leaf that arrives in pieces: feed them in, then take digest()
+    static Sha256 leafHasher();
+    static Digest combine(std::vector<Digest> level);
+    // Whether several leaves can actually be hashed at once on this machine
+    static bool isParallel();
+
+private:
+    using LeafBuffer = std::unique_ptr<std::vector<char>>;
+
+    size_t leafSize;
+    bool parallel;
+    size_t inFlightLimit;
+    bool finished;
+
+    // Inline mode hashes the open leaf as it fills; parallel mode copies it
+    // into a buffer that a pool task hashes once it is full
+    Sha256 openLeaf;
+    LeafBuffer openBuffer;
+    size_t openSize;
+
+    std::mutex mutex;
+    std::condition_variable leafDone;
+    std::vector<Digest> leaves;
+    std::vector<LeafBuffer> spareBuffers;
+    size_t inFlight;
+
+    void closeLeaf();
+    void submitLeaf(size_t index, LeafBuffer buffer, size_t length);
+    void waitForLeaves(size_t limit);
+};
+
+#endif // MERKLE_HASHER_HPP
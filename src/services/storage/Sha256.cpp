@@ -0,0 +1,244 @@
+#include "Sha256.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define RAPIDCOMM_X86_SHA 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+alignas(16) static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const uint32_t INITIAL_STATE[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+// ----------------------------- Block Functions --------------------------------->
+
+static inline uint32_t rotateRight(uint32_t value, int bits)
+{
+    return (value >> bits) | (value << (32 - bits));
+}
+
+static inline uint32_t loadBigEndian(const uint8_t* bytes)
+{
+    return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+           (static_cast<uint32_t>(bytes[2]) << 8) | static_cast<uint32_t>(bytes[3]);
+}
+
+static void compressPortable(uint32_t state[8], const uint8_t* blocks, size_t count)
+{
+    uint32_t w[64];
+    for (; count > 0; count--, blocks += Sha256::BLOCK_SIZE) {
+        for (int i = 0; i < 16; i++) {
+            w[i] = loadBigEndian(blocks + i * 4);
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; i++) {
+            uint32_t s1 = rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+            uint32_t choose = (e & f) ^ (~e & g);
+            uint32_t t1 = h + s1 + choose + K[i] + w[i];
+            uint32_t s0 = rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+            uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t t2 = s0 + majority;
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+#ifdef RAPIDCOMM_X86_SHA
+
+// Four rounds per step: sha256rnds2 does two, the message schedule for the
+// next group of four words comes from sha256msg1/msg2
+__attribute__((target("sha,sse4.1")))
+static void compressShaNi(uint32_t state[8], const uint8_t* blocks, size_t count)
+{
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // The instructions want the state as ABEF / CDGH
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    for (; count > 0; count--, blocks += Sha256::BLOCK_SIZE) {
+        __m128i savedAbef = state0;
+        __m128i savedCdgh = state1;
+        __m128i w[4];
+
+#pragma GCC unroll 16
+        for (int group = 0; group < 16; group++) {
+            int slot = group & 3;
+            if (group < 4) {
+                w[slot] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + group * 16)), byteSwap);
+            } else {
+                __m128i mixed = _mm_add_epi32(_mm_sha256msg1_epu32(w[slot], w[(group + 1) & 3]),
+                                              _mm_alignr_epi8(w[(group + 3) & 3], w[(group + 2) & 3], 4));
+                w[slot] = _mm_sha256msg2_epu32(mixed, w[(group + 3) & 3]);
+            }
+
+            __m128i message = _mm_add_epi32(w[slot], _mm_load_si128(reinterpret_cast<const __m128i*>(&K[group * 4])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, message);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(message, 0x0E));
+        }
+
+        state0 = _mm_add_epi32(state0, savedAbef);
+        state1 = _mm_add_epi32(state1, savedCdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+
+static bool cpuHasShaExtensions()
+{
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    bool sse41 = ecx & (1u << 19);
+    bool ssse3 = ecx & (1u << 9);
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return sse41 && ssse3 && (ebx & (1u << 29));
+}
+
+#endif
+
+// ----------------------------- Dispatch --------------------------------->
+
+struct CompressVariant {
+    Sha256::CompressFunction function;
+    const char* name;
+};
+
+static CompressVariant& getCompressVariant()
+{
+    static CompressVariant variant = []() -> CompressVariant {
+#ifdef RAPIDCOMM_X86_SHA
+        if (cpuHasShaExtensions()) {
+            return {compressShaNi, "sha-ni"};
+        }
+#endif
+        return {compressPortable, "portable"};
+    }();
+    return variant;
+}
+
+// ----------------------------- Sha256 --------------------------------->
+
+Sha256::Sha256()
+    : buffered(0),
+      totalLength(0),
+      compress(getCompressVariant().function)
+{
+    memcpy(state, INITIAL_STATE, sizeof(state));
+}
+
+void Sha256::update(const char* data, size_t length)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    totalLength += length;
+
+    if (buffered > 0) {
+        size_t take = std::min(length, BLOCK_SIZE - buffered);
+        memcpy(buffer + buffered, bytes, take);
+        buffered += take;
+        bytes += take;
+        length -= take;
+        if (buffered < BLOCK_SIZE) {
+            return;
+        }
+        compress(state, buffer, 1);
+        buffered = 0;
+    }
+
+    // Whole blocks are hashed straight from the caller's memory
+    size_t blocks = length / BLOCK_SIZE;
+    if (blocks > 0) {
+        compress(state, bytes, blocks);
+        bytes += blocks * BLOCK_SIZE;
+        length -= blocks * BLOCK_SIZE;
+    }
+
+    memcpy(buffer, bytes, length);
+    buffered = length;
+}
+
+void Sha256::digest(uint8_t out[DIGEST_SIZE]) const
+{
+    uint32_t finalState[8];
+    memcpy(finalState, state, sizeof(finalState));
+
+    // Padding: 0x80, zeros, then the bit length, filling one or two blocks
+    uint8_t tail[BLOCK_SIZE * 2] = {};
+    memcpy(tail, buffer, buffered);
+    tail[buffered] = 0x80;
+    size_t tailLength = buffered + 1 + 8 <= BLOCK_SIZE ? BLOCK_SIZE : BLOCK_SIZE * 2;
+    uint64_t bitLength = totalLength * 8;
+    for (int i = 0; i < 8; i++) {
+        tail[tailLength - 1 - i] = static_cast<uint8_t>(bitLength >> (i * 8));
+    }
+    compress(finalState, tail, tailLength / BLOCK_SIZE);
+
+    for (int i = 0; i < 8; i++) {
+        out[i * 4] = static_cast<uint8_t>(finalState[i] >> 24);
+        out[i * 4 + 1] = static_cast<uint8_t>(finalState[i] >> 16);
+        out[i * 4 + 2] = static_cast<uint8_t>(finalState[i] >> 8);
+        out[i * 4 + 3] = static_cast<uint8_t>(finalState[i]);
+    }
+}
+
+std::string Sha256::hexDigest() const
+{
+    uint8_t out[DIGEST_SIZE];
+    digest(out);
+    return toHex(out, DIGEST_SIZE);
+}
+
+std::string Sha256::toHex(const uint8_t* bytes, size_t length)
+{
+    static const char DIGITS[] = "0123456789abcdef";
+    std::string hex(length * 2, '0');
+    for (size_t i = 0; i < length; i++) {
+        hex[i * 2] = DIGITS[bytes[i] >> 4];
+        hex[i * 2 + 1] = DIGITS[bytes[i] & 0x0f];
+    }
+    return hex;
+}
+
+const char* Sha256::implementationName()
+{
+    return getCompressVariant().name;
+}
+
+void Sha256::usePortable()
+{
+    getCompressVariant() = {compressPortable, "portable"};
+}
@@ -0,0 +1,40 @@
+#ifndef SHA256_HPP
+#define SHA256_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Incremental SHA-256 (FIPS 180-4). On x86 CPUs with the SHA extensions the
+// block function runs on SHA-NI; everything else uses the portable version.
+// The choice is made once, from the CPU the process is running on.
+class Sha256
+{
+public:
+    static const size_t DIGEST_SIZE = 32;
+    static const size_t BLOCK_SIZE = 64;
+
+    Sha256();
+
+    void update(const char* data, size_t length);
+    // Digest of everything fed so far; the hasher can keep going after
+    void digest(uint8_t out[DIGEST_SIZE]) const;
+    std::string hexDigest() const;
+
+    static std::string toHex(const uint8_t* bytes, size_t length);
+    static const char* implementationName();
+    // Hashers created after this use the portable block function whatever
+    // the CPU offers, so the two can be checked against each other
+    static void usePortable();
+
+    using CompressFunction = void (*)(uint32_t state[8], const uint8_t* blocks, size_t count);
+
+private:
+    uint32_t state[8];
+    uint8_t buffer[BLOCK_SIZE];
+    size_t buffered;
+    uint64_t totalLength;
+    CompressFunction compress;
+};
+
+#endif // SHA256_HPP
@@ -0,0 +1,126 @@
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Bounded queue between exactly one producer thread and one consumer
+// thread. Handing an item over takes no lock, only an acquire load and a
+// release store. A side that finds the ring full (or empty) spins briefly
+// and then sleeps until the other side makes room (or pushes), so a slow
+// consumer holds the producer back instead of letting the queue grow.
+template <typename T>
+class SpscRing
+{
+public:
+    explicit SpscRing(size_t capacity)
+        : slots(roundUp(capacity)),
+          mask(slots.size() - 1),
+          head(0),
+          tail(0),
+          sleepers(0)
+    {
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer only
+    bool tryPush(const T& item)
+    {
+        size_t position = tail.load(std::memory_order_relaxed);
+        if (position - head.load(std::memory_order_acquire) == slots.size()) {
+            return false;
+        }
+        slots[position & mask] = item;
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    void push(const T& item)
+    {
+        waitFor([this, &item]() { return tryPush(item); });
+        wakeOtherSide();
+    }
+
+    // Consumer only
+    bool tryPop(T& item)
+    {
+        size_t position = head.load(std::memory_order_relaxed);
+        if (position == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = slots[position & mask];
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    void pop(T& item)
+    {
+        waitFor([this, &item]() { return tryPop(item); });
+        wakeOtherSide();
+    }
+
+private:
+    static const int SPIN_LIMIT = 64;
+
+    std::vector<T> slots;
+    size_t mask;
+    // Apart, so the two sides do not invalidate each other's cache line
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+    alignas(64) std::atomic<int> sleepers;
+    std::mutex mutex;
+    std::condition_variable changed;
+
+    static size_t roundUp(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    template <typename Attempt>
+    void waitFor(Attempt attempt)
+    {
+        for (int spin = 0; spin < SPIN_LIMIT; spin++) {
+            if (attempt()) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+
+        // Announced before the last attempt, so the other side either sees
+        // a sleeper or this attempt sees what it did
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            sleepers.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (attempt()) {
+                sleepers.fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
+            changed.wait(lock);
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    void wakeOtherSide()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_relaxed) > 0) {
+            // The sleeper holds the lock until it is waiting, so this
+            // notification cannot slip in before the wait
+            std::lock_guard<std::mutex> lock(mutex);
+            changed.notify_all();
+        }
+    }
+};
+
+#endif // SPSC_RING_HPP
@@ -1,4 +1,9 @@
 #include "StorageService.hpp"
+#include "ContentStore.hpp"
+#include "FileReceiver.hpp"
+#include "GroupCommitter.hpp"
+#include "UploadWriter.hpp"
+#include "UploadSession.hpp"
 #include "../http/BasePath.hpp"
 #include <iostream>
 #include <iomanip>
@@ -9,7 +14,10 @@
 #include <filesystem>
 #include <chrono>
 #include <functional>
+#include <mutex>
 #include <ctime>
+#include <cerrno>
+#include <unistd.h>
 
 // Colors for terminal output
 #define COLOR_GREEN   "\033[0;32m"
@@ -22,6 +30,10 @@
 // Default configuration
 static const size_t DEFAULT_MAX_FILE_SIZE = 2ULL * 1024 * 1024 * 1024; // 2GB
 static const size_t DEFAULT_CHUNK_SIZE = 1024 * 1024; // 1MB
+static const size_t DEFAULT_MAX_SESSIONS = 64;
+static const long SESSION_IDLE_TIMEOUT = 24 * 60 * 60; // Abandoned upload sessions are dropped after a day
+static const size_t DIRECT_IO_THRESHOLD = 16 * 1024 * 1024; // Smaller uploads are cheap to cache and often read back soon
+static const size_t MAX_NAME_VERSIONS = 1000; // Under the version policy, "name (1000).ext" is the last try
 
 // Helper to determine the project's root "uploads" directory
 static std::string getDefaultStorageDir() {
@@ -36,7 +48,14 @@ StorageService::StorageService()
     : storageDirectory(getDefaultStorageDir()),
       maxFileSize(DEFAULT_MAX_FILE_SIZE),
       chunkSize(DEFAULT_CHUNK_SIZE),
-      enableVerification(true)
+      maxSessions(DEFAULT_MAX_SESSIONS),
+      enableVerification(true),
+      useIoUring(false),
+      useContentStore(false),
+      durable(false),
+      useDirectIo(false),
+      usePipeline(false),
+      conflictPolicy(ConflictPolicy::Overwrite)
 {
     createStorageDirectory();
     // Storage service initialized silently
@@ -46,7 +65,14 @@ StorageService::StorageService(const std::string& storageDirectory)
     : storageDirectory(storageDirectory.empty() ? getDefaultStorageDir() : storageDirectory),
       maxFileSize(DEFAULT_MAX_FILE_SIZE),
       chunkSize(DEFAULT_CHUNK_SIZE),
-      enableVerification(true)
+      maxSessions(DEFAULT_MAX_SESSIONS),
+      enableVerification(true),
+      useIoUring(false),
+      useContentStore(false),
+      durable(false),
+      useDirectIo(false),
+      usePipeline(false),
+      conflictPolicy(ConflictPolicy::Overwrite)
 {
     // Ensure directory ends with slash
     if (this->storageDirectory.back() != '/') {
@@ -63,7 +89,7 @@ StorageService::~StorageService()
 
 // ----------------------------- Main Storage Operations --------------------------------->
 
-bool StorageService::saveFile(const std::string& filename, const std::vector<char>& fileData)
+bool StorageService::saveFile(const std::string& filename, std::string_view fileData)
 {
     if (filename.empty()) {
         logError("Cannot save file: filename is empty");
@@ -110,7 +136,7 @@ bool StorageService::saveFile(const std::string& filename, const std::vector<cha
     }
 }
 
-std::pair<bool, std::string> StorageService::saveFileWithVerification(const std::string& filename, const std::vector<char>& fileData)
+std::pair<bool, std::string> StorageService::saveFileWithVerification(const std::string& filename, std::string_view fileData, IntegrityHasher& hasher)
 {
     if (filename.empty()) {
         logError("Cannot save file: filename is empty");
@@ -128,43 +154,26 @@ std::pair<bool, std::string> StorageService::saveFileWithVerification(const std:
     }
 
     try {
-        std::string safeFilename = getSafeFilename(filename);
-        std::string fullPath = getFullPath(safeFilename);
-        
-        // Saving file with verification silently
-        
-        // Calculate SHA-256 hash for bit-perfect verification
-        std::string sha256Hash = calculateSHA256Hash(fileData);
-        // Hash calculated silently
-        // File data processed silently
-        
-        // Write file using atomic chunked method for all files
-        std::string fileType = getFileType(filename);
-        // Using atomic chunked write silently
-        
-        auto writeResult = writeFileInChunksAtomic(fullPath, fileData);
-        bool writeSuccess = writeResult.first;
-        std::string verifiedHash = writeResult.second;
-        
-        if (!writeSuccess) {
-            logError("Failed to write file atomically: " + fullPath);
+        hasher.update(fileData.data(), fileData.size());
+        if (!checkIntegrity(filename, hasher)) {
             return std::make_pair(false, "");
         }
         
-        // Verify file integrity if verification is enabled
-        if (enableVerification) {
-            if (sha256Hash != verifiedHash) {
-                logError("File integrity verification failed - hash mismatch");
-                logError("Expected: " + sha256Hash.substr(0, 16) + "...");
-                logError("Got: " + verifiedHash.substr(0, 16) + "...");
-                std::filesystem::remove(fullPath);
-                return std::make_pair(false, "");
-            }
-            // File integrity verified successfully
+        // Content the store already holds is linked, not written again
+        std::string hash = hasher.finish();
+        if (linkExistingFile(filename, fileData.size(), hash).first) {
+            return std::make_pair(true, hash);
+        }
+
+        // The data goes from the request buffer straight to disk; the byte
+        // count the kernel accepted is checked instead of reading it back
+        if (!writeFileAtomic(filename, fileData, hash)) {
+            logError("Failed to write file atomically: " + getFullPath(getSafeFilename(filename)));
+            return std::make_pair(false, "");
         }
         
         // File saved with bit-perfect verification
-        return std::make_pair(true, sha256Hash);
+        return std::make_pair(true, hash);
         
     } catch (const std::exception& e) {
         logError("Exception while saving file with verification: " + std::string(e.what()));
@@ -172,6 +181,276 @@ std::pair<bool, std::string> StorageService::saveFileWithVerification(const std:
     }
 }
 
+std::pair<bool, std::string> StorageService::saveStreamedFile(const std::string& filename, int socketFd, std::string_view bodyPrefix, size_t fileSize,
+                                                              IntegrityHasher& hasher)
+{
+    if (fileSize > maxFileSize) {
+        logError("File too large: " + getFileSizeString(fileSize) + " exceeds limit of " + getFileSizeString(maxFileSize));
+        return std::make_pair(false, "");
+    }
+
+    std::unique_ptr<UploadWriter> writer = beginUpload(filename, fileSize);
+    if (!writer) {
+        return std::make_pair(false, "");
+    }
+
+    // Whatever arrived with the headers goes first, the socket supplies the rest
+    size_t prefixSize = std::min(bodyPrefix.size(), fileSize);
+    if (!writer->write(bodyPrefix.data(), prefixSize)) {
+        logError("Failed to write file: " + writer->getTempPath());
+        return std::make_pair(false, "");
+    }
+
+    // The body is hashed out of the receive buffers, so the file is never read back
+    hasher.update(bodyPrefix.data(), prefixSize);
+
+    FileReceiver receiver(useIoUring);
+    receiver.setPipelined(usePipeline);
+    receiver.setObserver([&hasher](const char* data, size_t length) {
+        hasher.update(data, length);
+    });
+    bool success;
+    if (writer->isDirect() || receiver.isPipelined(fileSize - prefixSize)) {
+        // Hashed and written on the pipeline's own thread if pipelined; direct
+        // writes come from the writer's aligned buffer either way
+        success = receiver.receive(socketFd, fileSize - prefixSize, [&writer](const char* data, size_t length) {
+            return writer->write(data, length);
+        });
+    } else {
+        size_t received = 0;
+        success = receiver.receive(socketFd, writer->getDescriptor(), static_cast<off_t>(prefixSize), fileSize - prefixSize, received);
+        writer->advance(received);
+    }
+    if (!success) {
+        logError("Upload interrupted after " + getFileSizeString(writer->getSize()) + ": " + receiver.getLastError());
+        return std::make_pair(false, "");
+    }
+
+    // A body that does not match what the client declared is never published
+    if (!checkIntegrity(filename, hasher) || !finishUpload(*writer, hasher.finish())) {
+        return std::make_pair(false, "");
+    }
+    return std::make_pair(true, hasher.finish());
+}
+
+std::pair<bool, std::string> StorageService::linkExistingFile(const std::string& filename, size_t size, const std::string& hash)
+{
+    if (!useContentStore || filename.empty() || size > maxFileSize) {
+        return std::make_pair(false, "");
+    }
+
+    // Clients may send their hex in either case; the store names objects in lower case
+    std::string normalized = hash;
+    std::transform(normalized.begin(), normalized.end(), normalized.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    ContentStore store(storageDirectory, durable);
+    if (!store.contains(normalized, size)) {
+        return std::make_pair(false, "");
+    }
+    bool linked = claimName(getSafeFilename(filename), [&store, &normalized, size](const std::string& candidate, bool replace) {
+        return store.linkExisting(normalized, size, candidate, replace);
+    });
+    if (!linked || !syncToDisk(store.getIndexPath(), false) || !syncToDisk(storageDirectory, true)) {
+        return std::make_pair(false, "");
+    }
+    logInfo("Deduplicated: " + storedFilename);
+    return std::make_pair(true, normalized);
+}
+
+std::unique_ptr<UploadWriter> StorageService::beginUpload(const std::string& filename, size_t expectedSize)
+{
+    if (filename.empty()) {
+        logError("Cannot save file: filename is empty");
+        return nullptr;
+    }
+
+    std::unique_ptr<UploadWriter> writer(new UploadWriter(getFullPath(getSafeFilename(filename))));
+    if (!writer->open()) {
+        logError("Failed to create temporary file for: " + writer->getFinalPath());
+        return nullptr;
+    }
+
+    // Where the filesystem refuses either, the upload is written as before
+    if (expectedSize > 0) {
+        writer->reserve(expectedSize);
+        if (useDirectIo && expectedSize >= DIRECT_IO_THRESHOLD) {
+            writer->setDirect();
+        }
+    }
+    return writer;
+}
+
+bool StorageService::finishUpload(UploadWriter& writer, const std::string& hash)
+{
+    if (writer.getSize() > maxFileSize) {
+        logError("File too large: " + getFileSizeString(writer.getSize()) + " exceeds limit of " + getFileSizeString(maxFileSize));
+        return false;
+    }
+
+    if (!writer.close()) {
+        logError("Failed to write file: " + writer.getTempPath());
+        return false;
+    }
+
+    // The writer removes (or closes) its temp file once the file has a name
+    if (!publishFile(writer.getTempPath(), writer.getFinalPath().substr(storageDirectory.size()), hash)) {
+        logError("Failed to publish " + writer.getFinalPath());
+        return false;
+    }
+    return true;
+}
+
+// ----------------------------- Upload Sessions --------------------------------->
+
+std::shared_ptr<UploadSession> StorageService::createSession(const std::string& filename, size_t size, const std::string& originalHash)
+{
+    if (size > maxFileSize) {
+        logError("File too large: " + getFileSizeString(size) + " exceeds limit of " + getFileSizeString(maxFileSize));
+        return nullptr;
+    }
+
+    // Chunks are the tree's leaves, so a declared tree hash sets their size
+    // and can then be checked against the root at finalize
+    std::string hashError = IntegrityHasher::checkDeclared(originalHash);
+    if (!hashError.empty()) {
+        logError(hashError);
+        return nullptr;
+    }
+    if (!isSessionHash(originalHash)) {
+        logError("Upload sessions only take a merkle-sha256 hash, not: " + originalHash);
+        return nullptr;
+    }
+    size_t leafSize = chunkSize;
+    IntegrityHasher::negotiate(originalHash, size, leafSize);
+
+    // Counted and created under one lock, so a burst cannot overshoot the limit
+    static std::mutex sessionsMutex;
+    std::lock_guard<std::mutex> lock(sessionsMutex);
+    auto room = checkSessionCapacity();
+    if (!room.first) {
+        logError(room.second);
+        return nullptr;
+    }
+    std::shared_ptr<UploadSession> session = UploadSession::create(getSessionsDirectory(), getSafeFilename(filename), size, leafSize, originalHash);
+    if (!session) {
+        logError("Failed to create upload session for: " + filename);
+    }
+    return session;
+}
+
+bool StorageService::isSessionHash(std::string_view originalHash)
+{
+    size_t leafSize = 0;
+    return originalHash.empty() || IntegrityHasher::negotiate(originalHash, 0, leafSize) == IntegrityHasher::Algorithm::Merkle;
+}
+
+std::shared_ptr<UploadSession> StorageService::openSession(const std::string& id)
+{
+    return UploadSession::open(getSessionsDirectory(), id);
+}
+
+bool StorageService::receiveChunk(UploadSession& session, size_t index, int socketFd, std::string_view bodyPrefix)
+{
+    size_t length = session.getChunkLength(index);
+    off_t offset = static_cast<off_t>(session.getChunkOffset(index));
+    if (!session.reserveChunk(index)) {
+        logError("No space for chunk " + std::to_string(index) + " of session " + session.getId());
+        return false;
+    }
+
+    // The chunk's leaf digest is taken on the way in, so finalizing never reads the file
+    Sha256 leaf = MerkleHasher::leafHasher();
+    size_t prefixSize = std::min(bodyPrefix.size(), length);
+    for (size_t done = 0; done < prefixSize;) {
+        ssize_t written = pwrite(session.getDescriptor(), bodyPrefix.data() + done, prefixSize - done, offset + static_cast<off_t>(done));
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            logError("Failed to write chunk " + std::to_string(index) + " of session " + session.getId());
+            return false;
+        }
+        done += static_cast<size_t>(written);
+    }
+    leaf.update(bodyPrefix.data(), prefixSize);
+
+    FileReceiver receiver(useIoUring);
+    receiver.setObserver([&leaf](const char* data, size_t length) {
+        leaf.update(data, length);
+    });
+    size_t received = 0;
+    if (!receiver.receive(socketFd, session.getDescriptor(), offset + static_cast<off_t>(prefixSize), length - prefixSize, received)) {
+        logError("Chunk " + std::to_string(index) + " of session " + session.getId() + " interrupted: " + receiver.getLastError());
+        return false;
+    }
+
+    // The journal must never vouch for a chunk that is not on disk yet
+    if (!syncToDisk(session.getDataPath(), false)) {
+        return false;
+    }
+
+    MerkleHasher::Digest digest;
+    leaf.digest(digest.data());
+    if (!session.commitChunk(index, digest)) {
+        logError("Failed to record chunk " + std::to_string(index) + " of session " + session.getId());
+        return false;
+    }
+    return true;
+}
+
+std::pair<bool, std::string> StorageService::checkSessionCapacity() const
+{
+    UploadSession::removeExpired(getSessionsDirectory(), SESSION_IDLE_TIMEOUT);
+    size_t open = UploadSession::countSessions(getSessionsDirectory());
+    if (open >= maxSessions) {
+        return std::make_pair(false, "Too many open upload sessions: " + std::to_string(open) + " of " + std::to_string(maxSessions));
+    }
+    return std::make_pair(true, "");
+}
+
+std::pair<bool, std::string> StorageService::finalizeSession(UploadSession& session)
+{
+    std::string hash = IntegrityHasher::formatTree(session.getRoot(), session.getChunkSize());
+    if (IntegrityHasher::compare(session.getOriginalHash(), hash) == IntegrityHasher::Verdict::Mismatch) {
+        logError("Integrity check failed for " + session.getFilename() + ": expected " + session.getOriginalHash() + ", got " + hash);
+        // No way to tell which chunk is wrong, so the client starts over
+        session.remove();
+        return std::make_pair(false, hash);
+    }
+
+    if (!publishFile(session.getDataPath(), session.getFilename(), hash)) {
+        logError("Failed to publish " + getFullPath(session.getFilename()));
+        session.cancelFinalize();
+        return std::make_pair(false, "");
+    }
+    session.remove();
+    return std::make_pair(true, hash);
+}
+
+std::pair<bool, std::string> StorageService::checkCapacity(size_t incomingSize) const
+{
+    if (incomingSize > maxFileSize) {
+        return std::make_pair(false, "File too large: " + getFileSizeString(incomingSize) + " exceeds limit of " + getFileSizeString(maxFileSize));
+    }
+
+    std::error_code error;
+    std::filesystem::space_info space = std::filesystem::space(storageDirectory, error);
+    if (!error && incomingSize > space.available) {
+        return std::make_pair(false, "Not enough disk space: " + getFileSizeString(incomingSize) + " needed, " + getFileSizeString(space.available) + " available");
+    }
+    return std::make_pair(true, "");
+}
+
+bool StorageService::isNameTaken(const std::string& filename) const
+{
+    return conflictPolicy == ConflictPolicy::Reject && fileExists(filename);
+}
+
+const std::string& StorageService::getStoredFilename() const
+{
+    return storedFilename;
+}
+
 // ----------------------------- File Operations --------------------------------->
 
 bool StorageService::fileExists(const std::string& filename) const
@@ -200,6 +479,9 @@ bool StorageService::deleteFile(const std::string& filename)
     try {
         if (std::filesystem::exists(fullPath)) {
             std::filesystem::remove(fullPath);
+            if (useContentStore) {
+                ContentStore(storageDirectory, durable).release(getSafeFilename(filename));
+            }
             logInfo("File deleted: " + fullPath);
             return true;
         }
@@ -231,7 +513,6 @@ std::string StorageService::getStorageDirectory() const
 void StorageService::setMaxFileSize(size_t maxSize)
 {
     maxFileSize = maxSize;
-    logInfo("Max file size updated: " + getFileSizeString(maxFileSize));
 }
 
 size_t StorageService::getMaxFileSize() const
@@ -239,6 +520,52 @@ size_t StorageService::getMaxFileSize() const
     return maxFileSize;
 }
 
+void StorageService::setIoUringEnabled(bool enabled)
+{
+    useIoUring = enabled;
+}
+
+void StorageService::setChunkSize(size_t size)
+{
+    chunkSize = size;
+}
+
+void StorageService::setMaxSessions(size_t count)
+{
+    maxSessions = count;
+}
+
+void StorageService::setDedupEnabled(bool enabled)
+{
+    useContentStore = enabled;
+}
+
+void StorageService::setDurable(bool enabled)
+{
+    durable = enabled;
+}
+
+void StorageService::setDirectIo(bool enabled)
+{
+    useDirectIo = enabled;
+}
+
+void StorageService::setPipelineEnabled(bool enabled)
+{
+    usePipeline = enabled;
+}
+
+void StorageService::setConflictPolicy(const std::string& policy)
+{
+    if (policy == "version") {
+        conflictPolicy = ConflictPolicy::Version;
+    } else if (policy == "reject") {
+        conflictPolicy = ConflictPolicy::Reject;
+    } else {
+        conflictPolicy = ConflictPolicy::Overwrite;
+    }
+}
+
 // ----------------------------- Helper Functions --------------------------------->
 
 bool StorageService::createStorageDirectory()
@@ -287,6 +614,21 @@ std::string StorageService::getFullPath(const std::string& filename) const
     return storageDirectory + filename;
 }
 
+std::string StorageService::getVersionedFilename(const std::string& filename, size_t version) const
+{
+    // report.pdf -> report (1).pdf, like a browser saving a second copy
+    size_t lastDot = filename.find_last_of('.');
+    if (lastDot == std::string::npos || lastDot == 0) {
+        return filename + " (" + std::to_string(version) + ")";
+    }
+    return filename.substr(0, lastDot) + " (" + std::to_string(version) + ")" + filename.substr(lastDot);
+}
+
+std::string StorageService::getSessionsDirectory() const
+{
+    return storageDirectory + ".sessions/";
+}
+
 std::string StorageService::getFileType(const std::string& filename) const
 {
     size_t dotPos = filename.find_last_of('.');
@@ -361,197 +703,101 @@ std::string StorageService::getFileSizeString(size_t bytes) const
 
 // ----------------------------- Integrity Functions --------------------------------->
 
-uint32_t StorageService::calculateChecksum(const std::vector<char>& data) const
+bool StorageService::checkIntegrity(const std::string& filename, IntegrityHasher& hasher) const
 {
-    uint32_t checksum = 0;
-    for (size_t i = 0; i < data.size(); ++i) {
-        checksum += static_cast<uint8_t>(data[i]);
-        checksum = (checksum << 1) | (checksum >> 31); // Rotate left by 1
+    if (hasher.verify() == IntegrityHasher::Verdict::Mismatch) {
+        logError("Integrity check failed for " + filename + ": expected " + hasher.getExpected() + ", got " + hasher.finish());
+        return false;
     }
-    return checksum;
+    return true;
 }
 
-std::string StorageService::calculateFileHash(const std::vector<char>& data) const
+bool StorageService::writeFileAtomic(const std::string& filename, std::string_view fileData, const std::string& hash)
 {
-    // Legacy hash function - keeping for compatibility
-    std::hash<std::string> hasher;
-    std::string dataStr(data.begin(), data.end());
-    
-    // Multi-pass hashing for better distribution
-    size_t hash1 = hasher(dataStr);
-    size_t hash2 = hasher(dataStr + std::to_string(data.size()));
-    uint32_t checksum = calculateChecksum(data);
-    
-    std::ostringstream oss;
-    oss << std::hex << hash1 << hash2 << checksum;
-    return oss.str();
+    std::unique_ptr<UploadWriter> writer = beginUpload(filename);
+    if (!writer) {
+        return false;
+    }
+
+    if (!writer->write(fileData.data(), fileData.size()) || writer->getSize() != fileData.size()) {
+        logError("Failed to write file: " + writer->getTempPath() + " (" + getFileSizeString(writer->getSize()) + "/" + getFileSizeString(fileData.size()) + ")");
+        return false;
+    }
+
+    return finishUpload(*writer, hash);
 }
 
-std::string StorageService::calculateSHA256Hash(const std::vector<char>& data) const
+bool StorageService::publishFile(const std::string& sourcePath, const std::string& filename, const std::string& hash)
 {
-    // Simple hash algorithm compatible with frontend implementation
-    // Using deterministic algorithm that both client and server can reproduce
-    
-    uint32_t hash1 = 0;
-    uint32_t hash2 = 0;
-    uint32_t hash3 = 0;
-    
-    // Hash pass 1: Basic hash
-    for (size_t i = 0; i < data.size(); i++) {
-        hash1 = ((hash1 << 5) - hash1 + static_cast<unsigned char>(data[i])) & 0xffffffff;
-    }
-    
-    // Hash pass 2: With salt1 - process data first, then salt1
-    std::string salt1 = "salt1";
-    for (size_t i = 0; i < data.size(); i++) {
-        hash2 = ((hash2 << 5) - hash2 + static_cast<unsigned char>(data[i])) & 0xffffffff;
-    }
-    for (char c : salt1) {
-        hash2 = ((hash2 << 5) - hash2 + static_cast<unsigned char>(c)) & 0xffffffff;
-    }
-    
-    // Hash pass 3: With salt2 and size - process data first, then salt2
-    std::string salt2 = "salt2" + std::to_string(data.size());
-    for (size_t i = 0; i < data.size(); i++) {
-        hash3 = ((hash3 << 5) - hash3 + static_cast<unsigned char>(data[i])) & 0xffffffff;
+    // Data before the name that points at it, the name before the reply
+    if (!syncToDisk(sourcePath, false)) {
+        return false;
     }
-    for (char c : salt2) {
-        hash3 = ((hash3 << 5) - hash3 + static_cast<unsigned char>(c)) & 0xffffffff;
+
+    // With deduplication on, the name and the index change under one lock,
+    // so another upload to the same name cannot slip in between
+    ContentStore store(storageDirectory, durable);
+    std::unique_lock<std::mutex> indexLock;
+    if (useContentStore) {
+        indexLock = ContentStore::lockIndex();
     }
-    
-    // Calculate checksum (same as existing method)
-    uint32_t checksum = calculateChecksum(data);
-    
-    // Combine hashes and format as hex
-    std::ostringstream oss;
-    oss << std::hex << hash1 << hash2 << hash3 << checksum;
-    
-    // Pad to 64 characters
-    std::string result = oss.str();
-    while (result.length() < 64) {
-        result += "0";
+
+    // Linked, never copied: the file appears under its name complete or not at all
+    bool placed = claimName(filename, [this, &sourcePath](const std::string& candidate, bool replace) {
+        return UploadWriter::link(sourcePath, getFullPath(candidate), replace);
+    });
+    if (!placed) {
+        return false;
     }
-    if (result.length() > 64) {
-        result = result.substr(0, 64);
+    if (useContentStore) {
+        if (!store.adopt(sourcePath, storedFilename, hash)) {
+            logError("Failed to deduplicate " + storedFilename + ", kept as a plain file");
+        }
+        // Syncs batch with other uploads, so none of them wait on the lock
+        indexLock.unlock();
+        if (!syncToDisk(store.getIndexPath(), false)) {
+            return false;
+        }
     }
-    
-    return result;
-}
-
-bool StorageService::verifyIntegrity(const std::vector<char>& data, const std::string& expectedHash) const
-{
-    std::string actualHash = calculateFileHash(data);
-    return (actualHash == expectedHash);
+    return syncToDisk(storageDirectory, true);
 }
 
-std::pair<bool, std::string> StorageService::writeFileInChunksAtomic(const std::string& filepath, const std::vector<char>& fileData)
+bool StorageService::claimName(const std::string& filename, const std::function<bool(const std::string&, bool)>& place)
 {
-    try {
-        // Create temporary file path for atomic operation
-        std::string tempPath = filepath + ".tmp." + std::to_string(time(nullptr));
-        
-        std::ofstream file(tempPath, std::ios::binary | std::ios::out);
-        if (!file.is_open()) {
-            logError("Failed to create temporary file: " + tempPath);
-            return std::make_pair(false, "");
-        }
-        
-        size_t totalWritten = 0;
-        while (totalWritten < fileData.size()) {
-            size_t remainingSize = fileData.size() - totalWritten;
-            size_t currentChunkSize = std::min(chunkSize, remainingSize);
-            
-            file.write(fileData.data() + totalWritten, currentChunkSize);
-            
-            if (file.fail()) {
-                file.close();
-                std::filesystem::remove(tempPath);
-                logError("Failed to write chunk at position: " + std::to_string(totalWritten));
-                return std::make_pair(false, "");
-            }
-            
-            totalWritten += currentChunkSize;
-            file.flush();
-            
-            // Progress feedback for large files with more frequent updates
-            if (fileData.size() > 5 * 1024 * 1024) { // Show progress for files > 5MB
-                double progress = (double)totalWritten / fileData.size() * 100.0;
-                static int lastProgress = -1;
-                int currentProgress = (int)(progress / 10) * 10; // Every 10%
-                
-                if (currentProgress != lastProgress && currentProgress > 0) {
-                    std::string progressStr = "Write progress: " + std::to_string(currentProgress) + "% (" + 
-                                            getFileSizeString(totalWritten) + "/" + getFileSizeString(fileData.size()) + ")";
-                    logInfo(progressStr);
-                    lastProgress = currentProgress;
-                }
-            }
-        }
-        
-        file.close();
-        
-        // Verify file was written correctly by calculating hash
-        std::ifstream verifyFile(tempPath, std::ios::binary);
-        if (!verifyFile.is_open()) {
-            std::filesystem::remove(tempPath);
-            logError("Failed to open temporary file for verification");
-            return std::make_pair(false, "");
+    for (size_t version = 0; version <= MAX_NAME_VERSIONS; version++) {
+        std::string candidate = version == 0 ? filename : getVersionedFilename(filename, version);
+        errno = 0;
+        if (place(candidate, conflictPolicy == ConflictPolicy::Overwrite)) {
+            storedFilename = candidate;
+            return true;
         }
-        
-        std::vector<char> verifyData((std::istreambuf_iterator<char>(verifyFile)),
-                                     std::istreambuf_iterator<char>());
-        verifyFile.close();
-        
-        // Calculate hash of written file
-        std::string writtenHash = calculateSHA256Hash(verifyData);
-        
-        // Verify data integrity
-        if (verifyData.size() != fileData.size()) {
-            std::filesystem::remove(tempPath);
-            logError("File size mismatch after write: " + std::to_string(verifyData.size()) + " vs " + std::to_string(fileData.size()));
-            return std::make_pair(false, "");
+
+        // Only a name some other file holds is worth another try
+        bool taken = errno == EEXIST;
+        if (taken && conflictPolicy == ConflictPolicy::Reject) {
+            logError("Not replacing existing file: " + candidate);
         }
-        
-        // Atomically move temp file to final location
-        if (!atomicFileMove(tempPath, filepath)) {
-            std::filesystem::remove(tempPath);
-            logError("Failed to atomically move file to final location");
-            return std::make_pair(false, "");
+        if (!taken || conflictPolicy != ConflictPolicy::Version) {
+            return false;
         }
-        
-        // File written atomically with verification
-        return std::make_pair(true, writtenHash);
-        
-    } catch (const std::exception& e) {
-        logError("Exception during atomic write: " + std::string(e.what()));
-        return std::make_pair(false, "");
     }
+    logError("No free name left for: " + filename);
+    return false;
 }
 
-bool StorageService::verifyWrittenFile(const std::string& filepath, const std::vector<char>& originalData)
+bool StorageService::syncToDisk(const std::string& path, bool directory)
 {
-    try {
-        std::ifstream verifyFile(filepath, std::ios::binary);
-        if (!verifyFile.is_open()) {
-            return false;
-        }
-        
-        std::vector<char> verifyData((std::istreambuf_iterator<char>(verifyFile)),
-                                     std::istreambuf_iterator<char>());
-        verifyFile.close();
-        
-        // Check size first
-        if (verifyData.size() != originalData.size()) {
-            return false;
-        }
-        
-        // Verify integrity using hash
-        std::string originalHash = calculateFileHash(originalData);
-        return verifyIntegrity(verifyData, originalHash);
-        
-    } catch (const std::exception&) {
-        return false;
+    if (!durable) {
+        return true;
     }
+
+    // Shared by every upload, so concurrent ones land in the same batch
+    static GroupCommitter committer;
+    bool synced = directory ? committer.syncDirectory(path) : committer.syncFile(path);
+    if (!synced) {
+        logError("Failed to sync to disk: " + path);
+    }
+    return synced;
 }
 
 // ----------------------------- Logging Helpers --------------------------------->
@@ -561,26 +807,6 @@ void StorageService::logInfo(const std::string& message) const
     std::cout << COLOR_BLUE << "[Storage] " << message << COLOR_RESET << std::endl;
 }
 
-bool StorageService::atomicFileMove(const std::string& tempPath, const std::string& finalPath)
-{
-    try {
-        // Use rename for atomic operation (works on same filesystem)
-        if (std::rename(tempPath.c_str(), finalPath.c_str()) == 0) {
-            return true;
-        }
-        
-        // Fallback: copy + remove (less atomic but more compatible)
-        std::filesystem::copy_file(tempPath, finalPath, std::filesystem::copy_options::overwrite_existing);
-        std::filesystem::remove(tempPath);
-        
-        return std::filesystem::exists(finalPath);
-        
-    } catch (const std::exception& e) {
-        logError("Atomic move failed: " + std::string(e.what()));
-        return false;
-    }
-}
-
 void StorageService::logError(const std::string& message) const
 {
     std::cerr << COLOR_RED << "[Storage] ERROR: " << message << COLOR_RESET << std::endl;
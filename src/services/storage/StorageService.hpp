@@ -2,19 +2,65 @@
 #define STORAGE_SERVICE_HPP
 
 #include <string>
-#include <vector>
+#include <string_view>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include "IntegrityHasher.hpp"
+
+class UploadWriter;
+class UploadSession;
 
 class StorageService
 {
 public:
+    // What happens when an upload's name is already taken
+    enum class ConflictPolicy { Overwrite, Version, Reject };
+
     StorageService();
     explicit StorageService(const std::string& storageDirectory);
     ~StorageService();
 
     // Main storage operations
-    bool saveFile(const std::string& filename, const std::vector<char>& fileData);
-    std::pair<bool, std::string> saveFileWithVerification(const std::string& filename, const std::vector<char>& fileData);
+    // fileData is only read; callers pass a view into the buffer they already hold
+    bool saveFile(const std::string& filename, std::string_view fileData);
+    // Both feed hasher with the data as it passes through and return its digest;
+    // data that does not match the hash the hasher expects is not kept
+    std::pair<bool, std::string> saveFileWithVerification(const std::string& filename, std::string_view fileData, IntegrityHasher& hasher);
+    // Receives fileSize bytes (bodyPrefix already read) from a blocking socket
+    std::pair<bool, std::string> saveStreamedFile(const std::string& filename, int socketFd, std::string_view bodyPrefix, size_t fileSize,
+                                                  IntegrityHasher& hasher);
+
+    // Gives filename the stored content with this hash and size, without any
+    // data sent; returns the hash as the store knows it
+    std::pair<bool, std::string> linkExistingFile(const std::string& filename, size_t size, const std::string& hash);
+
+    // Streaming uploads: write into the temp file, then move it into place;
+    // with deduplication on, the content's hash decides whether it is stored.
+    // An expectedSize, if known, is reserved on disk up front
+    std::unique_ptr<UploadWriter> beginUpload(const std::string& filename, size_t expectedSize = 0);
+    bool finishUpload(UploadWriter& writer, const std::string& hash = "");
+    // Resumable uploads: chunks collect in a session under .sessions/ until it is finalized
+    std::shared_ptr<UploadSession> createSession(const std::string& filename, size_t size, const std::string& originalHash);
+    // Finalizing only yields a tree hash, so a session may declare no other
+    static bool isSessionHash(std::string_view originalHash);
+    std::shared_ptr<UploadSession> openSession(const std::string& id);
+    // Receives one whole chunk the caller has claimed (bodyPrefix already
+    // read) from a blocking socket; any number may run at once per session
+    bool receiveChunk(UploadSession& session, size_t index, int socketFd, std::string_view bodyPrefix);
+    // Moves a session's file into place once beginFinalize() succeeded and
+    // returns its tree hash; a hash that contradicts the declared one comes
+    // back with false
+    std::pair<bool, std::string> finalizeSession(UploadSession& session);
+    // Whether an upload of incomingSize bytes fits the size limit and the free disk space
+    std::pair<bool, std::string> checkCapacity(size_t incomingSize) const;
+    // Whether another upload session may be opened
+    std::pair<bool, std::string> checkSessionCapacity() const;
+    // Whether the reject policy refuses filename because a file already has it
+    bool isNameTaken(const std::string& filename) const;
+    // Name the last successful save used; under the version policy it can
+    // differ from the one asked for
+    const std::string& getStoredFilename() const;
     
     // File operations
     bool fileExists(const std::string& filename) const;
@@ -26,28 +72,49 @@ public:
     std::string getStorageDirectory() const;
     void setMaxFileSize(size_t maxSize);
     size_t getMaxFileSize() const;
+    void setIoUringEnabled(bool enabled);
+    void setChunkSize(size_t size);
+    // Upload sessions that may be open at once
+    void setMaxSessions(size_t count);
+    void setDedupEnabled(bool enabled);
+    // Uploads are only acknowledged once their data and name are on disk
+    void setDurable(bool enabled);
+    // Large uploads bypass the page cache (O_DIRECT) where the filesystem allows it
+    void setDirectIo(bool enabled);
+    // Large bodies are hashed and written on a second thread while the next buffers arrive
+    void setPipelineEnabled(bool enabled);
+    // "overwrite", "version" (name (1).ext, ...) or "reject"
+    void setConflictPolicy(const std::string& policy);
 
 private:
     std::string storageDirectory;
     size_t maxFileSize;
     size_t chunkSize;
+    size_t maxSessions;
     bool enableVerification;
+    bool useIoUring;
+    bool useContentStore;
+    bool durable;
+    bool useDirectIo;
+    bool usePipeline;
+    ConflictPolicy conflictPolicy;
+    std::string storedFilename;
     
     // Helper functions
     bool createStorageDirectory();
     std::string getSafeFilename(const std::string& filename) const;
     std::string getFullPath(const std::string& filename) const;
+    std::string getSessionsDirectory() const;
     std::string getFileType(const std::string& filename) const;
     std::string getFileSizeString(size_t bytes) const;
     
     // Integrity and optimization functions
-    uint32_t calculateChecksum(const std::vector<char>& data) const;
-    std::string calculateFileHash(const std::vector<char>& data) const;
-    std::string calculateSHA256Hash(const std::vector<char>& data) const;
-    bool verifyIntegrity(const std::vector<char>& data, const std::string& expectedHash) const;
-    std::pair<bool, std::string> writeFileInChunksAtomic(const std::string& filepath, const std::vector<char>& fileData);
-    bool verifyWrittenFile(const std::string& filepath, const std::vector<char>& originalData);
-    bool atomicFileMove(const std::string& tempPath, const std::string& finalPath);
+    bool checkIntegrity(const std::string& filename, IntegrityHasher& hasher) const;
+    bool writeFileAtomic(const std::string& filename, std::string_view fileData, const std::string& hash);
+    bool publishFile(const std::string& sourcePath, const std::string& filename, const std::string& hash);
+    bool claimName(const std::string& filename, const std::function<bool(const std::string&, bool)>& place);
+    std::string getVersionedFilename(const std::string& filename, size_t version) const;
+    bool syncToDisk(const std::string& path, bool directory);
     
     // Logging helpers
     void logInfo(const std::string& message) const;
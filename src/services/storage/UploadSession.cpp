@@ -0,0 +1,513 @@
+#include "UploadSession.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const size_t ID_BYTES = 16;
+static const size_t BITS_PER_WORD = 64;
+
+// Sessions some connection is using right now, keyed by their data path.
+// Only lookups take the lock; chunks are tracked in the sessions' bitmaps.
+struct SessionRegistry
+{
+    std::mutex mutex;
+    std::unordered_map<std::string, std::weak_ptr<UploadSession>> sessions;
+};
+
+static SessionRegistry& getRegistry()
+{
+    static SessionRegistry registry;
+    return registry;
+}
+
+static bool testBit(const std::atomic<uint64_t>* bits, size_t index)
+{
+    return bits[index / BITS_PER_WORD].load(std::memory_order_acquire) & (uint64_t(1) << index % BITS_PER_WORD);
+}
+
+static bool parseSize(const std::string& text, size_t& value)
+{
+    if (text.empty() || text.size() > 19 || text.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    value = static_cast<size_t>(std::stoull(text));
+    return true;
+}
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool parseDigest(const std::string& hex, MerkleHasher::Digest& digest)
+{
+    if (hex.size() != digest.size() * 2) {
+        return false;
+    }
+    for (size_t i = 0; i < digest.size(); i++) {
+        int high = hexValue(hex[i * 2]);
+        int low = hexValue(hex[i * 2 + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        digest[i] = static_cast<uint8_t>(high << 4 | low);
+    }
+    return true;
+}
+
+// ----------------------------- Constructor/Destructor --------------------------------->
+
+UploadSession::UploadSession(const std::string& directory, const std::string& id)
+    : directory(directory),
+      id(id),
+      size(0),
+      chunkSize(0),
+      dataFd(-1),
+      journalFd(-1),
+      bitmapWords(0),
+      finalizing(false)
+{
+}
+
+UploadSession::~UploadSession()
+{
+    if (dataFd >= 0) {
+        close(dataFd);
+    }
+    if (journalFd >= 0) {
+        close(journalFd);
+    }
+}
+
+// ----------------------------- Create/Open --------------------------------->
+
+std::shared_ptr<UploadSession> UploadSession::create(const std::string& sessionsDirectory, const std::string& filename,
+                                                     size_t size, size_t chunkSize, const std::string& originalHash)
+{
+    // Every field is one line of the metadata file
+    auto hasLineBreak = [](const std::string& text) { return text.find_first_of("\r\n") != std::string::npos; };
+    if (filename.empty() || size == 0 || hasLineBreak(filename) || hasLineBreak(originalHash) ||
+        chunkSize < MerkleHasher::MIN_LEAF_SIZE || chunkSize > MerkleHasher::MAX_LEAF_SIZE) {
+        return nullptr;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(sessionsDirectory, error);
+
+    std::random_device random;
+    uint8_t bytes[ID_BYTES];
+    for (size_t i = 0; i < ID_BYTES; i++) {
+        bytes[i] = static_cast<uint8_t>(random());
+    }
+
+    std::shared_ptr<UploadSession> session(new UploadSession(sessionsDirectory, Sha256::toHex(bytes, ID_BYTES)));
+    session->filename = filename;
+    session->size = size;
+    session->chunkSize = chunkSize;
+    session->originalHash = originalHash;
+    session->allocateChunks();
+
+    // The data file is sized up front so chunks can land at their offsets in
+    // any order, but its blocks are only taken as chunks arrive: a session
+    // costs no more disk than was actually sent to it
+    if (!session->openData(O_RDWR | O_CREAT | O_EXCL) || ftruncate(session->dataFd, static_cast<off_t>(size)) != 0 ||
+        !session->writeMetadata()) {
+        session->remove();
+        return nullptr;
+    }
+
+    SessionRegistry& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (auto entry = registry.sessions.begin(); entry != registry.sessions.end();) {
+        entry = entry->second.expired() ? registry.sessions.erase(entry) : std::next(entry);
+    }
+    registry.sessions[session->dataPath] = session;
+    return session;
+}
+
+std::shared_ptr<UploadSession> UploadSession::open(const std::string& sessionsDirectory, const std::string& id)
+{
+    if (!isValidId(id)) {
+        return nullptr;
+    }
+
+    std::shared_ptr<UploadSession> session(new UploadSession(sessionsDirectory, id));
+    SessionRegistry& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::weak_ptr<UploadSession>& live = registry.sessions[session->pathFor(".tmp")];
+    if (std::shared_ptr<UploadSession> shared = live.lock()) {
+        return shared;
+    }
+
+    // Loaded under the lock, so two connections never load the same session twice
+    if (!session->readMetadata() || !session->openData(O_RDWR)) {
+        registry.sessions.erase(session->pathFor(".tmp"));
+        return nullptr;
+    }
+    session->allocateChunks();
+    session->readJournal();
+    live = session;
+    return session;
+}
+
+bool UploadSession::isValidId(const std::string& id)
+{
+    return id.size() == ID_BYTES * 2 && id.find_first_not_of("0123456789abcdef") == std::string::npos;
+}
+
+void UploadSession::removeExpired(const std::string& sessionsDirectory, long maxIdleSeconds)
+{
+    std::error_code error;
+    auto now = std::filesystem::file_time_type::clock::now();
+    SessionRegistry& registry = getRegistry();
+    for (const auto& entry : std::filesystem::directory_iterator(sessionsDirectory, error)) {
+        if (entry.path().extension() != ".session") {
+            continue;
+        }
+        {
+            std::filesystem::path data = entry.path();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            auto live = registry.sessions.find(data.replace_extension(".tmp").string());
+            if (live != registry.sessions.end() && !live->second.expired()) {
+                continue;
+            }
+        }
+        // The journal is touched by every chunk, the metadata only at creation
+        std::filesystem::path journal = entry.path();
+        journal.replace_extension(".chunks");
+        auto lastUsed = std::filesystem::last_write_time(entry.path(), error);
+        if (error) {
+            continue;
+        }
+        auto lastChunk = std::filesystem::last_write_time(journal, error);
+        if (!error) {
+            lastUsed = std::max(lastUsed, lastChunk);
+        }
+        if (now - lastUsed > std::chrono::seconds(maxIdleSeconds)) {
+            UploadSession(sessionsDirectory, entry.path().stem().string()).remove();
+        }
+    }
+}
+
+size_t UploadSession::countSessions(const std::string& sessionsDirectory)
+{
+    std::error_code error;
+    size_t count = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(sessionsDirectory, error)) {
+        if (entry.path().extension() == ".session") {
+            count++;
+        }
+    }
+    return count;
+}
+
+// ----------------------------- Chunks --------------------------------->
+
+bool UploadSession::locateChunk(size_t offset, size_t length, size_t& index) const
+{
+    if (offset % chunkSize != 0 || offset >= size) {
+        return false;
+    }
+    index = offset / chunkSize;
+    return length == getChunkLength(index);
+}
+
+size_t UploadSession::getChunkCount() const
+{
+    return (size + chunkSize - 1) / chunkSize;
+}
+
+size_t UploadSession::getChunkOffset(size_t index) const
+{
+    return index * chunkSize;
+}
+
+size_t UploadSession::getChunkLength(size_t index) const
+{
+    return std::min(chunkSize, size - getChunkOffset(index));
+}
+
+bool UploadSession::claimChunk(size_t index)
+{
+    if (index >= getChunkCount()) {
+        return false;
+    }
+
+    uint64_t bit = uint64_t(1) << index % BITS_PER_WORD;
+    if (claimedBits[index / BITS_PER_WORD].fetch_or(bit) & bit) {
+        return false;
+    }
+    // Pairs with beginFinalize(): either it sees this claim or this sees its flag
+    if (finalizing.load()) {
+        releaseChunk(index);
+        return false;
+    }
+    return true;
+}
+
+void UploadSession::releaseChunk(size_t index)
+{
+    claimedBits[index / BITS_PER_WORD].fetch_and(~(uint64_t(1) << index % BITS_PER_WORD));
+}
+
+bool UploadSession::reserveChunk(size_t index)
+{
+    if (index >= getChunkCount()) {
+        return false;
+    }
+#ifdef __linux__
+    // Real blocks rather than a hole: the disk cannot run out halfway
+    // through the chunk, and a chunk arriving out of order is still contiguous
+    if (fallocate(dataFd, 0, static_cast<off_t>(getChunkOffset(index)), static_cast<off_t>(getChunkLength(index))) != 0 &&
+        errno != EOPNOTSUPP) {
+        return false;
+    }
+#endif
+    return true;
+}
+
+bool UploadSession::commitChunk(size_t index, const MerkleHasher::Digest& digest)
+{
+    if (index >= getChunkCount()) {
+        return false;
+    }
+
+    // One short O_APPEND write per chunk, so lines from concurrent chunks
+    // never interleave; a line cut off by a crash is ignored on load
+    std::string line = std::to_string(index) + " " + Sha256::toHex(digest.data(), digest.size()) + "\n";
+    if (write(journalFd, line.data(), line.size()) != static_cast<ssize_t>(line.size())) {
+        return false;
+    }
+
+    digests[index] = digest;
+    receivedBits[index / BITS_PER_WORD].fetch_or(uint64_t(1) << index % BITS_PER_WORD, std::memory_order_release);
+    return true;
+}
+
+bool UploadSession::hasChunk(size_t index) const
+{
+    return index < getChunkCount() && testBit(receivedBits.get(), index);
+}
+
+bool UploadSession::isComplete() const
+{
+    size_t chunks = getChunkCount();
+    for (size_t word = 0; word < bitmapWords; word++) {
+        size_t bits = std::min(chunks - word * BITS_PER_WORD, BITS_PER_WORD);
+        uint64_t full = bits == BITS_PER_WORD ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+        if (receivedBits[word].load(std::memory_order_acquire) != full) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool UploadSession::beginFinalize()
+{
+    if (!stopChunks()) {
+        return false;
+    }
+    if (!isComplete()) {
+        cancelFinalize();
+        return false;
+    }
+    return true;
+}
+
+void UploadSession::cancelFinalize()
+{
+    finalizing.store(false);
+}
+
+bool UploadSession::beginRemove()
+{
+    return stopChunks();
+}
+
+bool UploadSession::stopChunks()
+{
+    if (finalizing.exchange(true)) {
+        return false;
+    }
+    for (size_t word = 0; word < bitmapWords; word++) {
+        if (claimedBits[word].load() != 0) {
+            cancelFinalize();
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<std::pair<size_t, size_t>> UploadSession::getReceivedRanges() const
+{
+    std::vector<std::pair<size_t, size_t>> ranges;
+    for (size_t i = 0; i < getChunkCount(); i++) {
+        if (!hasChunk(i)) {
+            continue;
+        }
+        size_t start = getChunkOffset(i);
+        size_t end = start + getChunkLength(i);
+        if (!ranges.empty() && ranges.back().second == start) {
+            ranges.back().second = end;
+        } else {
+            ranges.emplace_back(start, end);
+        }
+    }
+    return ranges;
+}
+
+MerkleHasher::Digest UploadSession::getRoot() const
+{
+    return MerkleHasher::combine(digests);
+}
+
+void UploadSession::remove()
+{
+    {
+        SessionRegistry& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.sessions.erase(pathFor(".tmp"));
+    }
+    // Other connections may still hold the session; closing here would let
+    // their descriptor numbers be reused under them
+    std::remove(pathFor(".session").c_str());
+    std::remove(pathFor(".chunks").c_str());
+    std::remove(pathFor(".tmp").c_str());
+}
+
+// ----------------------------- Accessors --------------------------------->
+
+const std::string& UploadSession::getId() const
+{
+    return id;
+}
+
+const std::string& UploadSession::getFilename() const
+{
+    return filename;
+}
+
+size_t UploadSession::getSize() const
+{
+    return size;
+}
+
+size_t UploadSession::getChunkSize() const
+{
+    return chunkSize;
+}
+
+const std::string& UploadSession::getOriginalHash() const
+{
+    return originalHash;
+}
+
+const std::string& UploadSession::getDataPath() const
+{
+    return dataPath;
+}
+
+int UploadSession::getDescriptor() const
+{
+    return dataFd;
+}
+
+// ----------------------------- Persistence --------------------------------->
+
+std::string UploadSession::pathFor(const char* extension) const
+{
+    return (std::filesystem::path(directory) / (id + extension)).string();
+}
+
+void UploadSession::allocateChunks()
+{
+    bitmapWords = (getChunkCount() + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    digests.resize(getChunkCount());
+    receivedBits.reset(new std::atomic<uint64_t>[bitmapWords]);
+    claimedBits.reset(new std::atomic<uint64_t>[bitmapWords]);
+    for (size_t word = 0; word < bitmapWords; word++) {
+        receivedBits[word].store(0);
+        claimedBits[word].store(0);
+    }
+}
+
+bool UploadSession::writeMetadata() const
+{
+    // Written aside and renamed, so a crash never leaves half a file behind
+    std::string path = pathFor(".session");
+    std::string tempPath = path + ".new";
+    {
+        std::ofstream file(tempPath, std::ios::trunc);
+        file << "filename=" << filename << "\n"
+             << "size=" << size << "\n"
+             << "chunkSize=" << chunkSize << "\n"
+             << "originalHash=" << originalHash << "\n";
+        if (!file.good()) {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+    return std::rename(tempPath.c_str(), path.c_str()) == 0;
+}
+
+bool UploadSession::readMetadata()
+{
+    std::ifstream file(pathFor(".session"));
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            continue;
+        }
+        std::string key = line.substr(0, equals);
+        std::string value = line.substr(equals + 1);
+        if (key == "filename") filename = value;
+        else if (key == "size") parseSize(value, size);
+        else if (key == "chunkSize") parseSize(value, chunkSize);
+        else if (key == "originalHash") originalHash = value;
+    }
+    return !filename.empty() && size > 0 && chunkSize >= MerkleHasher::MIN_LEAF_SIZE && chunkSize <= MerkleHasher::MAX_LEAF_SIZE;
+}
+
+void UploadSession::readJournal()
+{
+    std::ifstream file(pathFor(".chunks"));
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t space = line.find(' ');
+        size_t index = 0;
+        MerkleHasher::Digest digest;
+        if (file.eof() || space == std::string::npos || !parseSize(line.substr(0, space), index) ||
+            index >= getChunkCount() || !parseDigest(line.substr(space + 1), digest)) {
+            continue; // Torn or foreign line
+        }
+        digests[index] = digest;
+        receivedBits[index / BITS_PER_WORD].fetch_or(uint64_t(1) << index % BITS_PER_WORD);
+    }
+}
+
+bool UploadSession::openData(int flags)
+{
+    dataPath = pathFor(".tmp");
+    dataFd = ::open(dataPath.c_str(), flags, 0644);
+    journalFd = ::open(pathFor(".chunks").c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    return dataFd >= 0 && journalFd >= 0;
+}
+
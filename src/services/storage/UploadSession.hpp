@@ -0,0 +1,110 @@
+#ifndef UPLOAD_SESSION_HPP
+#define UPLOAD_SESSION_HPP
+
+#include "MerkleHasher.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A resumable upload. The file is assembled in <id>.tmp inside the sessions
+// directory, <id>.session holds what was asked for and <id>.chunks is an
+// append-only journal with one line per chunk that made it to disk, carrying
+// that chunk's leaf digest. Everything lives on disk, so a session picks up
+// where it left off after a server restart.
+//
+// While a session is in use it is shared: every connection sending chunks
+// of it gets the same object, writes its chunk straight to its offset and
+// flips bits in lock-free bitmaps, so one file can arrive over many
+// connections at once.
+class UploadSession
+{
+public:
+    ~UploadSession();
+
+    UploadSession(const UploadSession&) = delete;
+    UploadSession& operator=(const UploadSession&) = delete;
+
+    static std::shared_ptr<UploadSession> create(const std::string& sessionsDirectory, const std::string& filename,
+                                                 size_t size, size_t chunkSize, const std::string& originalHash);
+    // The live session if another connection holds it, else loaded from disk
+    static std::shared_ptr<UploadSession> open(const std::string& sessionsDirectory, const std::string& id);
+    static bool isValidId(const std::string& id);
+    // Removes sessions nobody has touched for maxIdleSeconds
+    static void removeExpired(const std::string& sessionsDirectory, long maxIdleSeconds);
+    // Sessions on disk, in use or not
+    static size_t countSessions(const std::string& sessionsDirectory);
+
+    // Index of the chunk that offset and length describe exactly, if any
+    bool locateChunk(size_t offset, size_t length, size_t& index) const;
+    size_t getChunkCount() const;
+    size_t getChunkOffset(size_t index) const;
+    size_t getChunkLength(size_t index) const;
+
+    // A chunk is written by one connection at a time, and never once
+    // finalizing has begun
+    bool claimChunk(size_t index);
+    void releaseChunk(size_t index);
+    // Allocates disk blocks for a claimed chunk before its bytes arrive
+    bool reserveChunk(size_t index);
+    // Records a claimed chunk whose bytes are already in the data file
+    bool commitChunk(size_t index, const MerkleHasher::Digest& digest);
+    bool hasChunk(size_t index) const;
+    bool isComplete() const;
+
+    // Succeeds for one caller, once every chunk is in and none is being
+    // rewritten; chunks are refused from then on
+    bool beginFinalize();
+    void cancelFinalize();
+    // Succeeds for one caller once no chunk is being written, complete or
+    // not; chunks are refused from then on and the caller removes the session
+    bool beginRemove();
+    // Merged [start, end) byte ranges received so far
+    std::vector<std::pair<size_t, size_t>> getReceivedRanges() const;
+    // Tree hash of the whole file, from the journal alone
+    MerkleHasher::Digest getRoot() const;
+
+    // Deletes the session's bookkeeping; the data file too unless it was
+    // moved away. Its descriptors stay open until the last holder lets go.
+    void remove();
+
+    const std::string& getId() const;
+    const std::string& getFilename() const;
+    size_t getSize() const;
+    size_t getChunkSize() const;
+    const std::string& getOriginalHash() const;
+    const std::string& getDataPath() const;
+    int getDescriptor() const;
+
+private:
+    std::string directory;
+    std::string id;
+    std::string filename;
+    size_t size;
+    size_t chunkSize;
+    std::string originalHash;
+    std::string dataPath;
+    int dataFd;
+    int journalFd;
+
+    // A digest is written by the chunk's claimant before its received bit is set
+    std::vector<MerkleHasher::Digest> digests;
+    std::unique_ptr<std::atomic<uint64_t>[]> receivedBits;
+    std::unique_ptr<std::atomic<uint64_t>[]> claimedBits;
+    size_t bitmapWords;
+    std::atomic<bool> finalizing;
+
+    UploadSession(const std::string& directory, const std::string& id);
+    std::string pathFor(const char* extension) const;
+    void allocateChunks();
+    bool writeMetadata() const;
+    bool readMetadata();
+    void readJournal();
+    bool openData(int flags);
+    bool stopChunks();
+};
+
+#endif // UPLOAD_SESSION_HPP
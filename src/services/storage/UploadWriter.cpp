@@ -0,0 +1,282 @@
+#include "UploadWriter.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+static const size_t DIRECT_ALIGNMENT = 4096;                // At least the logical block size of any disk in use
+static const size_t DIRECT_BUFFER_SIZE = BufferPool::LARGE; // Each direct write is one full, page-aligned buffer
+static const char TEMPORARY_DIRECTORY[] = ".tmp/";
+
+static std::string getDirectory(const std::string &path)
+{
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? "./" : path.substr(0, slash + 1);
+}
+
+// A unique name for a file that only passes through on its way to path:
+// hidden, and on the same filesystem so that linking and renaming work
+static std::string makeTemporaryName(const std::string &path, const char *prefix)
+{
+    std::string directory = getDirectory(path) + TEMPORARY_DIRECTORY;
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        return "";
+    }
+    return directory + prefix + ".XXXXXX";
+}
+
+// ----------------------------- Constructor/Destructor --------------------------------->
+
+UploadWriter::UploadWriter(const std::string &finalPath)
+    : finalPath(finalPath),
+      fileFd(-1),
+      size(0),
+      anonymous(false),
+      trimOnClose(false),
+      buffered(0)
+{
+}
+
+UploadWriter::~UploadWriter()
+{
+    if (fileFd >= 0) {
+        ::close(fileFd);
+    }
+    // A published file has a name of its own by now
+    if (!anonymous && !tempPath.empty()) {
+        std::remove(tempPath.c_str());
+    }
+}
+
+// ----------------------------- Writing --------------------------------->
+
+bool UploadWriter::open()
+{
+#ifdef O_TMPFILE
+    // In the target's directory, so linking it there never crosses filesystems
+    std::string directory = getDirectory(finalPath);
+    fileFd = ::open(directory.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0644);
+    if (fileFd >= 0) {
+        anonymous = true;
+        tempPath = "/proc/self/fd/" + std::to_string(fileFd);
+        return true;
+    }
+#endif
+
+    // Unique per upload, so concurrent uploads of one name never collide
+    tempPath = makeTemporaryName(finalPath, "upload");
+    fileFd = tempPath.empty() ? -1 : mkstemp(&tempPath[0]);
+    if (fileFd == -1) {
+        tempPath.clear();
+        return false;
+    }
+    fchmod(fileFd, 0644);
+    return true;
+}
+
+bool UploadWriter::reserve(size_t expectedSize)
+{
+#ifdef __linux__
+    if (expectedSize > 0 && fallocate(fileFd, 0, 0, static_cast<off_t>(expectedSize)) == 0) {
+        trimOnClose = true;
+        return true;
+    }
+#endif
+    return false;
+}
+
+bool UploadWriter::setDirect()
+{
+#ifdef O_DIRECT
+    if (directBuffer || size % DIRECT_ALIGNMENT != 0) {
+        return static_cast<bool>(directBuffer);
+    }
+    int flags = fcntl(fileFd, F_GETFL);
+    if (flags < 0 || fcntl(fileFd, F_SETFL, flags | O_DIRECT) != 0) {
+        return false;
+    }
+    directBuffer = BufferPool::acquire(DIRECT_BUFFER_SIZE);
+    if (!directBuffer) {
+        fcntl(fileFd, F_SETFL, flags);
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool UploadWriter::isDirect() const
+{
+    return static_cast<bool>(directBuffer);
+}
+
+bool UploadWriter::write(const char *data, size_t length)
+{
+    if (directBuffer) {
+        while (length > 0) {
+            size_t copied = std::min(length, DIRECT_BUFFER_SIZE - buffered);
+            memcpy(directBuffer.data() + buffered, data, copied);
+            buffered += copied;
+            size += copied;
+            data += copied;
+            length -= copied;
+            if (buffered == DIRECT_BUFFER_SIZE && !flushDirect(DIRECT_BUFFER_SIZE)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    while (length > 0) {
+        ssize_t written = pwrite(fileFd, data, length, static_cast<off_t>(size));
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+        size += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+void UploadWriter::advance(size_t length)
+{
+    size += length;
+}
+
+bool UploadWriter::close()
+{
+    if (fileFd < 0) {
+        return false;
+    }
+    if (directBuffer && !finishDirect()) {
+        return false;
+    }
+    // Whatever lies past the end, reserved or padding, goes back to the filesystem
+    if (trimOnClose && ftruncate(fileFd, static_cast<off_t>(size)) != 0) {
+        return false;
+    }
+    trimOnClose = false;
+    if (anonymous) {
+        return true;
+    }
+    int result = ::close(fileFd);
+    fileFd = -1;
+    return result == 0;
+}
+
+bool UploadWriter::link(const std::string &sourcePath, const std::string &finalPath, bool replace)
+{
+    // linkat() never replaces a name, so a conflict is reported rather than
+    // a file lost; following the /proc link reaches an anonymous inode
+    if (linkat(AT_FDCWD, sourcePath.c_str(), AT_FDCWD, finalPath.c_str(), AT_SYMLINK_FOLLOW) == 0) {
+        return true;
+    }
+    if (errno != EEXIST || !replace) {
+        return false;
+    }
+
+    // Taking a name over needs rename(), which needs a source name: the
+    // file gets a hidden one for just that instant
+    std::string linkPath = makeTemporaryName(finalPath, "link");
+    int linkFd = linkPath.empty() ? -1 : mkstemp(&linkPath[0]);
+    if (linkFd < 0) {
+        return false;
+    }
+    ::close(linkFd);
+    std::remove(linkPath.c_str());
+    if (linkat(AT_FDCWD, sourcePath.c_str(), AT_FDCWD, linkPath.c_str(), AT_SYMLINK_FOLLOW) != 0) {
+        return false;
+    }
+    bool renamed = std::rename(linkPath.c_str(), finalPath.c_str()) == 0;
+    // rename() between two links to one inode does nothing and leaves the source
+    std::remove(linkPath.c_str());
+    return renamed;
+}
+
+void UploadWriter::removeTemporaryFiles(const std::string &directory)
+{
+    std::error_code error;
+    std::filesystem::remove_all(directory + TEMPORARY_DIRECTORY, error);
+}
+
+// ----------------------------- Direct I/O --------------------------------->
+
+bool UploadWriter::flushDirect(size_t length)
+{
+    // size counts buffered bytes too, so the buffer starts where they do
+    off_t offset = static_cast<off_t>(size - buffered);
+    const char *data = directBuffer.data();
+    while (length > 0) {
+        ssize_t written = pwrite(fileFd, data, length, offset);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+        offset += written;
+    }
+    buffered = 0;
+    return true;
+}
+
+bool UploadWriter::finishDirect()
+{
+    // O_DIRECT only writes whole blocks: the tail goes out padded with zeros
+    // and the file is cut back to its real size
+    if (buffered > 0) {
+        size_t padded = (buffered + DIRECT_ALIGNMENT - 1) / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT;
+        memset(directBuffer.data() + buffered, 0, padded - buffered);
+        if (!flushDirect(padded)) {
+            return false;
+        }
+        trimOnClose = true;
+    }
+
+    directBuffer.release();
+    int flags = fcntl(fileFd, F_GETFL);
+    if (flags >= 0) {
+        fcntl(fileFd, F_SETFL, flags & ~O_DIRECT);
+    }
+#ifdef POSIX_FADV_DONTNEED
+    // Whatever of the file still found its way into the cache goes too
+    posix_fadvise(fileFd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+    return true;
+}
+
+// ----------------------------- Accessors --------------------------------->
+
+int UploadWriter::getDescriptor() const
+{
+    return fileFd;
+}
+
+size_t UploadWriter::getSize() const
+{
+    return size;
+}
+
+const std::string &UploadWriter::getTempPath() const
+{
+    return tempPath;
+}
+
+const std::string &UploadWriter::getFinalPath() const
+{
+    return finalPath;
+}
@@ -0,0 +1,70 @@
+#ifndef UPLOAD_WRITER_HPP
+#define UPLOAD_WRITER_HPP
+
+#include "../server/BufferPool.hpp"
+#include <cstddef>
+#include <string>
+
+// File an upload is streamed into before StorageService gives it a name.
+// Where the filesystem supports O_TMPFILE it is an anonymous inode, which
+// nothing can collide with and which vanishes with its descriptor if the
+// upload (or the server) dies; elsewhere a uniquely named temp file under
+// the hidden .tmp/ directory next to the target, removed with the writer.
+//
+// Large uploads can bypass the page cache: with O_DIRECT, writes collect in
+// an aligned buffer from the BufferPool and go to disk a full buffer at a
+// time, so a multi-GB upload neither evicts the files being served nor
+// waits on writeback of its own dirty pages.
+class UploadWriter
+{
+public:
+    explicit UploadWriter(const std::string &finalPath);
+    ~UploadWriter();
+
+    UploadWriter(const UploadWriter&) = delete;
+    UploadWriter& operator=(const UploadWriter&) = delete;
+
+    bool open();
+    // Allocates expectedSize bytes up front, so the file is laid out in few
+    // extents and the disk cannot fill up halfway; the unused rest goes on close()
+    bool reserve(size_t expectedSize);
+    // Writes from here on skip the page cache; false where the filesystem
+    // refuses O_DIRECT, and writes stay buffered
+    bool setDirect();
+    bool isDirect() const;
+    bool write(const char *data, size_t length);
+    // Accounts for bytes written straight to getDescriptor() at getSize()
+    void advance(size_t length);
+    // Done writing, a partly filled direct buffer included; an anonymous file
+    // stays open, it only lives as long as its descriptor
+    bool close();
+
+    // Gives the file at sourcePath (a /proc/self/fd path for an anonymous
+    // one) the name finalPath as well. Without replace an existing name
+    // fails with EEXIST; with it, the file takes the name over atomically.
+    static bool link(const std::string &sourcePath, const std::string &finalPath, bool replace);
+    // Clears what a crash left in directory's .tmp/; only while nothing writes there
+    static void removeTemporaryFiles(const std::string &directory);
+
+    // Only for writing straight to the file when the writer is not direct
+    int getDescriptor() const;
+    size_t getSize() const;
+    // Names the file while the writer is alive, also when it is anonymous
+    const std::string &getTempPath() const;
+    const std::string &getFinalPath() const;
+
+private:
+    std::string finalPath;
+    std::string tempPath;
+    int fileFd;
+    size_t size;
+    bool anonymous;
+    bool trimOnClose;
+    BufferPool::Buffer directBuffer;
+    size_t buffered;
+
+    bool flushDirect(size_t length);
+    bool finishDirect();
+};
+
+#endif // UPLOAD_WRITER_HPP
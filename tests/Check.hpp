@@ -0,0 +1,41 @@
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+#include <iostream>
+#include <string>
+
+// Just enough of a test harness for the unit tests: CHECK reports a failed
+// condition with its line and carries on, and main() returns finish()
+static int checkFailures = 0;
+
+#define CHECK(condition) checkCondition((condition), #condition, __FILE__, __LINE__)
+#define CHECK_EQUAL(actual, expected) checkEqual((actual), (expected), #actual, __FILE__, __LINE__)
+
+static inline void checkCondition(bool passed, const char* expression, const char* file, int line)
+{
+    if (!passed) {
+        std::cerr << file << ":" << line << ": CHECK(" << expression << ") failed" << std::endl;
+        checkFailures++;
+    }
+}
+
+template <typename Actual, typename Expected>
+static void checkEqual(const Actual& actual, const Expected& expected, const char* expression, const char* file, int line)
+{
+    if (!(actual == expected)) {
+        std::cerr << file << ":" << line << ": " << expression << " is " << actual << ", expected " << expected << std::endl;
+        checkFailures++;
+    }
+}
+
+static inline int finish(const std::string& name)
+{
+    if (checkFailures > 0) {
+        std::cerr << name << ": " << checkFailures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << name << ": all checks passed" << std::endl;
+    return 0;
+}
+
+#endif // CHECK_HPP
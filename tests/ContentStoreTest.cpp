@@ -0,0 +1,169 @@
+#include "Check.hpp"
+#include "storage/ContentStore.hpp"
+#include "storage/UploadWriter.hpp"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+
+static const std::string HASH_A = "sha256:aa" + std::string(62, '1');
+static const std::string HASH_B = "sha256:bb" + std::string(62, '2');
+static const std::string HASH_C = "sha256:cc" + std::string(62, '3');
+
+static std::string makeDirectory()
+{
+    char pattern[] = "/tmp/content-store-test.XXXXXX";
+    return std::string(mkdtemp(pattern)) + "/";
+}
+
+static void writeFile(const std::string& path, const std::string& contents)
+{
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+    std::ofstream(path, std::ios::binary) << contents;
+}
+
+static std::string readFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+static std::string objectPath(const std::string& directory, const std::string& hash)
+{
+    std::string name = "sha256-" + hash.substr(7);
+    return directory + ".objects/" + name.substr(7, 2) + "/" + name;
+}
+
+static std::set<std::string> readLines(const std::string& path)
+{
+    std::set<std::string> lines;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        lines.insert(line);
+    }
+    return lines;
+}
+
+// The index is loaded once per objects directory; another spelling of the
+// same directory loads it again from disk, as a restarted server would
+static std::string reopened(const std::string& directory)
+{
+    return directory + "./";
+}
+
+static void checkReplay()
+{
+    std::string directory = makeDirectory();
+    writeFile(directory + "one", "aaaa");
+    writeFile(directory + "two", "aaaa");
+    writeFile(objectPath(directory, HASH_A), "aaaa");
+    writeFile(objectPath(directory, HASH_B), "bbbb");
+    writeFile(objectPath(directory, HASH_C), "cc"); // Stored, then the server crashed before indexing it
+    std::string strayLink = directory + ".objects/aa/.tmp/link.abcdef";
+    writeFile(strayLink, "aaaa"); // Crashed while taking a name over
+
+    // "two" moved from B to A, "gone" was deleted behind the server's back,
+    // and the last line was torn by a crash
+    std::string objectA = "sha256-" + HASH_A.substr(7);
+    std::string objectB = "sha256-" + HASH_B.substr(7);
+    writeFile(directory + ".objects/index", objectA + " one\n" + objectB + " two\n" + objectB + " gone\n" +
+                                             "- two\n" + objectA + " two\n" + objectB + " tor");
+
+    ContentStore store(directory);
+    CHECK(store.contains(HASH_A, 4));
+    CHECK(!store.contains(HASH_A, 5));
+    CHECK(!store.contains(HASH_B, 4));
+    CHECK(!std::filesystem::exists(objectPath(directory, HASH_B)));
+    CHECK(!std::filesystem::exists(objectPath(directory, HASH_C)));
+    CHECK(!std::filesystem::exists(strayLink));
+
+    // The torn line forced a rewrite down to the live references
+    std::set<std::string> expected = {objectA + " one", objectA + " two"};
+    CHECK(readLines(store.getIndexPath()) == expected);
+
+    // Releasing the last name drops the object, and that survives a reload
+    store.release("one");
+    CHECK(std::filesystem::exists(objectPath(directory, HASH_A)));
+    std::filesystem::remove(directory + "two");
+    store.release("two");
+    CHECK(!std::filesystem::exists(objectPath(directory, HASH_A)));
+    CHECK(!ContentStore(reopened(directory)).contains(HASH_A, 4));
+
+    std::filesystem::remove_all(directory);
+}
+
+static void checkCompaction()
+{
+    std::string directory = makeDirectory();
+    std::string source = directory + "source";
+    writeFile(source, "aaaa");
+    ContentStore store(directory);
+
+    // Every round adds a reference and removes it again: two lines each,
+    // none of them live, so the journal has to be rewritten along the way
+    for (int round = 0; round < 1000; round++) {
+        {
+            std::unique_lock<std::mutex> lock = ContentStore::lockIndex();
+            CHECK(UploadWriter::link(source, directory + "name", true));
+            CHECK(store.adopt(source, "name", HASH_A));
+        }
+        store.release("name");
+    }
+    CHECK(readLines(store.getIndexPath()).size() < 1100);
+
+    // Taking a name over leaves no other name behind where clients look
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        std::string name = entry.path().filename().string();
+        CHECK(name == "source" || name == "name" || name[0] == '.');
+    }
+
+    // What is left replays to the same state: one name, one object
+    {
+        std::unique_lock<std::mutex> lock = ContentStore::lockIndex();
+        CHECK(UploadWriter::link(source, directory + "kept", true));
+        CHECK(store.adopt(source, "kept", HASH_A));
+    }
+    CHECK(ContentStore(reopened(directory)).contains(HASH_A, 4));
+    std::filesystem::remove_all(directory);
+}
+
+static void checkAdoptReadsTheSource()
+{
+    std::string directory = makeDirectory();
+    std::string source = directory + "upload.tmp";
+    writeFile(source, "ours");
+    ContentStore store(directory);
+
+    // Another upload has already put its own bytes under the name; the
+    // object must still be made from this upload's file
+    writeFile(directory + "name", "theirs");
+    {
+        std::unique_lock<std::mutex> lock = ContentStore::lockIndex();
+        CHECK(store.adopt(source, "name", HASH_A));
+    }
+    CHECK_EQUAL(readFile(objectPath(directory, HASH_A)), "ours");
+
+    // Content already stored: the new name gives way to the stored copy
+    writeFile(directory + "second", "ours");
+    {
+        std::unique_lock<std::mutex> lock = ContentStore::lockIndex();
+        CHECK(store.adopt(directory + "second", "second", HASH_A));
+    }
+    CHECK_EQUAL(readFile(directory + "second"), "ours");
+    CHECK(store.contains(HASH_A, 4));
+
+    std::filesystem::remove_all(directory);
+}
+
+int main()
+{
+    checkReplay();
+    checkCompaction();
+    checkAdoptReadsTheSource();
+    return finish("ContentStoreTest");
+}
@@ -0,0 +1,122 @@
+#include "Check.hpp"
+#include "storage/MerkleHasher.hpp"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+static const size_t LEAF_SIZE = MerkleHasher::MIN_LEAF_SIZE;
+
+// Roots the web client's calculateMerkleRoot (utils.js) gives for the same
+// data and leaf size; the server has to agree with it byte for byte
+struct KnownRoot {
+    size_t size;
+    size_t leaves;
+    const char* root;
+};
+
+static const KnownRoot KNOWN_ROOTS[] = {
+    {0, 1, "6e340b9cffb37a989ca544e6bb780a2c78901d3fb33738768511a30617afa01d"},     // One empty leaf
+    {100, 1, "6ce21f846e0b0ac9552c0aabc9ac9e49ba76d8dbafffb54f9ebb6706c1f794d8"},   // A partial leaf
+    {8192, 2, "fb32229d03e4710e9af8dafc939bd58964a2014a056b8696996d4b2b26e3b6b5"},  // One pair
+    {12288, 3, "7dd05c23d1d806f8724ca26a50331c2cf7e9b0204b103badf79aabe7bd60bda7"}, // An unpaired third
+    {20580, 6, "31077aeafe5123120b61dd87b8867e1d4bfec679a8630f1813c6515c47cf586a"}, // Odd one level up
+    {28672, 7, "8aacedf32a2e20fb77ee282a3bd270696efa2e9ddd9ff3bfe0f2cfe6ff468d3e"}, // Odd on two levels
+};
+
+static std::string makeData(size_t size)
+{
+    std::string data(size, '\0');
+    for (size_t i = 0; i < size; i++) {
+        data[i] = static_cast<char>((i * 31 + 7) & 0xff);
+    }
+    return data;
+}
+
+static std::string toHex(const MerkleHasher::Digest& digest)
+{
+    return Sha256::toHex(digest.data(), digest.size());
+}
+
+static MerkleHasher::Digest hashNode(const MerkleHasher::Digest& left, const MerkleHasher::Digest& right)
+{
+    Sha256 hasher;
+    const char tag = 0x01;
+    hasher.update(&tag, 1);
+    hasher.update(reinterpret_cast<const char*>(left.data()), left.size());
+    hasher.update(reinterpret_cast<const char*>(right.data()), right.size());
+    MerkleHasher::Digest digest;
+    hasher.digest(digest.data());
+    return digest;
+}
+
+static void checkCombineShape()
+{
+    std::string data = makeData(3 * LEAF_SIZE);
+    MerkleHasher::Digest a = MerkleHasher::hashLeaf(data.data(), LEAF_SIZE);
+    MerkleHasher::Digest b = MerkleHasher::hashLeaf(data.data() + LEAF_SIZE, LEAF_SIZE);
+    MerkleHasher::Digest c = MerkleHasher::hashLeaf(data.data() + 2 * LEAF_SIZE, LEAF_SIZE);
+
+    // A lone leaf is the root; a pair gets a parent; an unpaired node moves up unchanged
+    CHECK(MerkleHasher::combine({a}) == a);
+    CHECK(MerkleHasher::combine({a, b}) == hashNode(a, b));
+    CHECK(MerkleHasher::combine({a, b, c}) == hashNode(hashNode(a, b), c));
+
+    // Leaves are tagged 0x00, so a leaf never hashes like the node above it
+    Sha256 leaf;
+    const char tag = 0x00;
+    leaf.update(&tag, 1);
+    leaf.update(data.data(), LEAF_SIZE);
+    MerkleHasher::Digest expected;
+    leaf.digest(expected.data());
+    CHECK(a == expected);
+}
+
+static void checkKnownRoots()
+{
+    for (const KnownRoot& known : KNOWN_ROOTS) {
+        std::string data = makeData(known.size);
+
+        // Fed at once and in pieces that never line up with a leaf
+        for (size_t piece : {known.size, static_cast<size_t>(1000)}) {
+            MerkleHasher tree(LEAF_SIZE);
+            for (size_t offset = 0; offset < data.size(); offset += std::max<size_t>(piece, 1)) {
+                tree.update(data.data() + offset, std::min(piece, data.size() - offset));
+            }
+            CHECK_EQUAL(toHex(tree.finish()), known.root);
+            CHECK_EQUAL(tree.getLeaves().size(), known.leaves);
+        }
+
+        // Leaf digests combined afterwards, as a session's journal is at finalize
+        std::vector<MerkleHasher::Digest> leaves;
+        for (size_t offset = 0; offset < data.size() || leaves.empty(); offset += LEAF_SIZE) {
+            leaves.push_back(MerkleHasher::hashLeaf(data.data() + offset, std::min(LEAF_SIZE, data.size() - offset)));
+        }
+        CHECK_EQUAL(toHex(MerkleHasher::combine(leaves)), known.root);
+    }
+}
+
+// Leaves too big to copy out for the pool are hashed inline, to the same root
+static void checkLargeLeaves()
+{
+    for (size_t leafSize : {MerkleHasher::PARALLEL_MEMORY / 4, MerkleHasher::PARALLEL_MEMORY}) {
+        std::string data = makeData(2 * leafSize + 100);
+        MerkleHasher tree(leafSize);
+        for (size_t offset = 0; offset < data.size(); offset += 65536) {
+            tree.update(data.data() + offset, std::min<size_t>(65536, data.size() - offset));
+        }
+
+        std::vector<MerkleHasher::Digest> leaves;
+        for (size_t offset = 0; offset < data.size(); offset += leafSize) {
+            leaves.push_back(MerkleHasher::hashLeaf(data.data() + offset, std::min(leafSize, data.size() - offset)));
+        }
+        CHECK(tree.finish() == MerkleHasher::combine(leaves));
+    }
+}
+
+int main()
+{
+    checkCombineShape();
+    checkKnownRoots();
+    checkLargeLeaves();
+    return finish("MerkleHasherTest");
+}
@@ -0,0 +1,67 @@
+#include "Check.hpp"
+#include "storage/Sha256.hpp"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// FIPS 180-4 examples (and the NIST long-message vector), each checked
+// fed at once, byte by byte and in uneven pieces that straddle blocks
+struct Vector {
+    std::string message;
+    const char* digest;
+};
+
+static std::string hashWhole(const std::string& message)
+{
+    Sha256 hasher;
+    hasher.update(message.data(), message.size());
+    return hasher.hexDigest();
+}
+
+static std::string hashInPieces(const std::string& message, size_t piece)
+{
+    Sha256 hasher;
+    for (size_t offset = 0; offset < message.size(); offset += piece) {
+        hasher.update(message.data() + offset, std::min(piece, message.size() - offset));
+    }
+    return hasher.hexDigest();
+}
+
+static void checkVectors(const std::vector<Vector>& vectors)
+{
+    for (const Vector& vector : vectors) {
+        CHECK_EQUAL(hashWhole(vector.message), vector.digest);
+        CHECK_EQUAL(hashInPieces(vector.message, 1), vector.digest);
+        CHECK_EQUAL(hashInPieces(vector.message, 63), vector.digest);
+        CHECK_EQUAL(hashInPieces(vector.message, 65), vector.digest);
+    }
+
+    // digest() leaves the hasher able to go on
+    Sha256 hasher;
+    hasher.update("ab", 2);
+    hasher.hexDigest();
+    hasher.update("c", 1);
+    CHECK_EQUAL(hasher.hexDigest(), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
+
+int main()
+{
+    std::vector<Vector> vectors = {
+        {"", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+        {"abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+        {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+         "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+        {"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+         "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1"},
+        {std::string(1000000, 'a'), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"},
+    };
+
+    // Whatever this CPU dispatches to (SHA-NI on most x86), then the portable code
+    std::cout << "Sha256: " << Sha256::implementationName() << std::endl;
+    checkVectors(vectors);
+    Sha256::usePortable();
+    std::cout << "Sha256: " << Sha256::implementationName() << std::endl;
+    checkVectors(vectors);
+
+    return finish("Sha256Test");
+}
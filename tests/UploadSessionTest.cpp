@@ -0,0 +1,112 @@
+#include "Check.hpp"
+#include "storage/UploadSession.hpp"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+static const size_t CHUNK_SIZE = MerkleHasher::MIN_LEAF_SIZE;
+static const size_t FILE_SIZE = 2 * CHUNK_SIZE + 100; // Two full chunks and a short last one
+static const char DECLARED_HASH[] = "merkle-sha256:4096:0000000000000000000000000000000000000000000000000000000000000000";
+
+static std::string makeData(size_t size)
+{
+    std::string data(size, '\0');
+    for (size_t i = 0; i < size; i++) {
+        data[i] = static_cast<char>((i * 31 + 7) & 0xff);
+    }
+    return data;
+}
+
+// What a connection does with one chunk once its bytes are in hand
+static bool sendChunk(UploadSession& session, size_t index, const std::string& data)
+{
+    if (!session.claimChunk(index)) {
+        return false;
+    }
+    size_t offset = session.getChunkOffset(index);
+    size_t length = session.getChunkLength(index);
+    bool written = pwrite(session.getDescriptor(), data.data() + offset, length, static_cast<off_t>(offset)) ==
+                   static_cast<ssize_t>(length);
+    bool committed = written && session.commitChunk(index, MerkleHasher::hashLeaf(data.data() + offset, length));
+    session.releaseChunk(index);
+    return committed;
+}
+
+int main()
+{
+    char pattern[] = "/tmp/upload-session-test.XXXXXX";
+    std::string directory = std::string(mkdtemp(pattern)) + "/";
+    std::string data = makeData(FILE_SIZE);
+
+    std::string id;
+    {
+        std::shared_ptr<UploadSession> session = UploadSession::create(directory, "file.bin", FILE_SIZE, CHUNK_SIZE, DECLARED_HASH);
+        CHECK(session != nullptr);
+        if (!session) {
+            return finish("UploadSessionTest");
+        }
+        id = session->getId();
+        CHECK_EQUAL(session->getChunkCount(), 3u);
+        CHECK(sendChunk(*session, 2, data));
+        CHECK(sendChunk(*session, 0, data));
+        // A chunk is written by one connection at a time
+        CHECK(session->claimChunk(1));
+        CHECK(!session->claimChunk(1));
+        session->releaseChunk(1);
+    }
+
+    // Nobody holds it any more, so this reloads it from disk as after a restart
+    {
+        std::shared_ptr<UploadSession> session = UploadSession::open(directory, id);
+        CHECK(session != nullptr);
+        if (!session) {
+            return finish("UploadSessionTest");
+        }
+        CHECK_EQUAL(session->getFilename(), "file.bin");
+        CHECK_EQUAL(session->getSize(), FILE_SIZE);
+        CHECK_EQUAL(session->getChunkSize(), CHUNK_SIZE);
+        CHECK_EQUAL(session->getOriginalHash(), DECLARED_HASH);
+        CHECK(session->hasChunk(0));
+        CHECK(!session->hasChunk(1));
+        CHECK(session->hasChunk(2));
+        auto ranges = session->getReceivedRanges();
+        CHECK_EQUAL(ranges.size(), 2u);
+        if (ranges.size() == 2) {
+            CHECK_EQUAL(ranges[0].second, CHUNK_SIZE);
+            CHECK_EQUAL(ranges[1].first, 2 * CHUNK_SIZE);
+            CHECK_EQUAL(ranges[1].second, FILE_SIZE);
+        }
+        CHECK(!session->beginFinalize());
+        CHECK(sendChunk(*session, 1, data));
+    }
+
+    // A line cut off by a crash is ignored rather than read as a chunk
+    {
+        std::ofstream journal(directory + id + ".chunks", std::ios::app);
+        journal << "1 0123";
+    }
+
+    std::shared_ptr<UploadSession> session = UploadSession::open(directory, id);
+    CHECK(session != nullptr);
+    if (!session) {
+        return finish("UploadSessionTest");
+    }
+    CHECK(session->isComplete());
+    MerkleHasher tree(CHUNK_SIZE);
+    tree.update(data.data(), data.size());
+    CHECK(session->getRoot() == tree.finish());
+
+    // Only one of finalizing or removing wins, and removing leaves nothing behind
+    CHECK(session->beginFinalize());
+    CHECK(!session->beginRemove());
+    session->remove();
+    CHECK_EQUAL(UploadSession::countSessions(directory), 0u);
+    CHECK(!std::filesystem::exists(directory + id + ".tmp"));
+
+    session.reset();
+    std::filesystem::remove_all(directory);
+    return finish("UploadSessionTest");
+}